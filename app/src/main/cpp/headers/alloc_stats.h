@@ -0,0 +1,43 @@
+#ifndef ALLOCATION_STATS
+#define ALLOCATION_STATS
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Heap accounting per protocol phase. Built with FROST_ALLOC_STATS, the
+ * library is linked with malloc, calloc, realloc and free wrapped (ld
+ * --wrap); BoringSSL is linked in statically, so OPENSSL_malloc and
+ * everything behind it is counted as well. Each allocation is charged to the
+ * phase the calling thread is in. Without the flag nothing is counted and
+ * alloc_stats_enabled is false.
+ */
+typedef enum {
+  ALLOC_PHASE_IDLE,        // outside any phase
+  ALLOC_PHASE_DKG,         // commitments, shares, keys
+  ALLOC_PHASE_PREPROCESS,  // nonce pairs and their commitments
+  ALLOC_PHASE_SIGN,        // tuple, responses, signature
+  ALLOC_PHASE_VERIFY,      // signature verification
+  ALLOC_PHASE_COUNT
+} alloc_phase;
+
+typedef struct {
+  uint64_t allocs;  // malloc, calloc and realloc calls that returned memory
+  uint64_t frees;
+  uint64_t bytes;   // allocated, as malloc_usable_size counts them
+  uint64_t peak;    // most bytes live at once during the phase, all threads
+} alloc_counters;
+
+bool alloc_stats_enabled();
+
+// Charges the calling thread's allocations to phase; returns the previous one
+alloc_phase alloc_phase_enter(alloc_phase phase);
+
+void alloc_stats_get(alloc_phase phase, alloc_counters* out);
+
+// Zeroes the counters; the bytes live now are every phase's starting peak
+void alloc_stats_reset();
+
+const char* alloc_phase_name(alloc_phase phase);
+
+#endif
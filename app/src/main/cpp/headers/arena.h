@@ -0,0 +1,67 @@
+#ifndef SESSION_ARENA
+#define SESSION_ARENA
+
+#include "../boringssl/include/openssl/ec.h"
+#include <stddef.h>
+
+/*
+ * Session arena: every protocol object of one DKG and signing session (list
+ * nodes, packets, coefficient lists, tuples, received shares, the points in
+ * them) is carved out of a few large blocks instead of one malloc each.
+ *
+ * Objects are never released one by one. arena_free ends the session in one
+ * pass: it frees the points the arena handed out, wipes every byte handed
+ * out with OPENSSL_cleanse, and returns the blocks. Secrets that must go
+ * before the session ends (coefficients, shares) are still wiped early by
+ * their owners.
+ *
+ * Points are allocated by BoringSSL and only tracked here; they hold public
+ * values (commitments, keys). Scratch that lives within one call, and
+ * objects that outlive the session (the participants' keys, the signature,
+ * nonce stores), do not come from the arena.
+ *
+ * arena_reset instead rewinds an arena for the next session of the same
+ * shape: the bytes are wiped but the blocks and points are kept and handed
+ * out again, so once a session has sized it the arena stops allocating.
+ *
+ * An arena belongs to one thread at a time.
+ */
+
+// bytes per block; larger requests get a block of their own
+#define ARENA_BLOCK_SIZE (16 * 1024)
+
+typedef struct arena_block arena_block;
+typedef struct arena_points arena_points;
+
+typedef struct {
+  arena_block* blocks;  // newest first; the head has the free space
+  arena_points* points;
+  size_t used;      // bytes handed out, alignment included
+  size_t reserved;  // bytes held in blocks
+  size_t point_count;
+
+  // kept by arena_reset for reuse
+  arena_block* spare_blocks;
+  EC_POINT** spare_points;
+  size_t spare_count;
+  size_t spare_capacity;
+} session_arena;
+
+session_arena* arena_new();
+
+// size zeroed bytes aligned for any object; NULL if out of memory
+void* arena_alloc(session_arena* arena, size_t size);
+
+void* arena_dup(session_arena* arena, const void* data, size_t size);
+
+// A point freed with the arena
+EC_POINT* arena_point_new(session_arena* arena);
+
+EC_POINT* arena_point_dup(session_arena* arena, const EC_POINT* point);
+
+// Wipes and takes back everything handed out, keeping the memory for reuse
+void arena_reset(session_arena* arena);
+
+void arena_free(session_arena* arena);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef BATCH_VERIFICATION
+#define BATCH_VERIFICATION
+
+#include "../boringssl/include/openssl/bn.h"
+#include "../boringssl/include/openssl/ec.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "context.h"
+
+/*
+ * One archived signature: the signed message, the group commitment R and
+ * response z from its signature_packet, and the group public key Y.
+ */
+typedef struct {
+  const uint8_t* m;
+  size_t m_size;
+  const EC_POINT* R;
+  const BIGNUM* signature;
+  const EC_POINT* public_key;
+} signature_batch_item;
+
+/*
+ * Verifies G ^ z_i = R_i * Y_i ^ H(R_i, m_i) for every item. With random ρ_i,
+ * a slice of the batch is accepted by one combined equation
+ *
+ *   G ^ (∑ ρ_i * z_i) = ∏ R_i ^ ρ_i * Y_i ^ (ρ_i * c_i)
+ *
+ * evaluated as a single multi-scalar multiplication, in which consecutive
+ * items signed under the same key share one Y term. The combined check runs
+ * over chunks of the batch; only a chunk that fails is re-checked item by
+ * item to find the invalid entries.
+ *
+ * The batch is split into contiguous slices over up to `threads` worker
+ * threads (values below 2, or small batches, verify on the calling thread,
+ * with ctx; workers use their thread's context).
+ * results[i] reports item i.
+ * Returns true only when every item verified.
+ */
+#define BATCH_VERIFY_MAX_THREADS 64
+
+bool verify_signature_batch(const signature_batch_item* items, size_t count,
+                            int threads, bool* results, frost_ctx* ctx);
+
+#endif
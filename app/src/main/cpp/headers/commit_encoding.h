@@ -0,0 +1,27 @@
+#ifndef COMMITMENT_ENCODING
+#define COMMITMENT_ENCODING
+
+#include "../boringssl/include/openssl/ec.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "context.h"
+
+/*
+ * The fixed-size encoding of the DKG commitments 𝜙_j_k. A dealer's row is
+ * its t encoded points back to back, as pub_commit_packet carries it and as
+ * the commit_store (commit_store.h) keeps it.
+ */
+
+// uncompressed SEC1 points, as in the nonce store: decoding needs no sqrt
+#define COMMIT_POINT_BYTES 65
+
+// Encodes count points back to back into out, e.g. a dealer's row
+bool commit_points_encode(uint8_t* out, EC_POINT* const* points, size_t count,
+                          frost_ctx* ctx);
+
+// out = the point encoded at in; false if it is not a valid point
+bool commit_point_decode(EC_POINT* out, const uint8_t* in, frost_ctx* ctx);
+
+#endif
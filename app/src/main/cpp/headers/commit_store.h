@@ -0,0 +1,64 @@
+#ifndef COMMITMENT_STORE
+#define COMMITMENT_STORE
+
+#include "../boringssl/include/openssl/ec.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "commit_encoding.h"
+#include "context.h"
+#include "presence.h"
+
+/*
+ * The DKG commitments of a group, published once and read by every local
+ * participant: the participants perform_signing runs side by side, or those
+ * of a multi-participant host, share one copy instead of each holding n rows.
+ *
+ * The copy is one block of encoded points (commit_encoding.h) instead of n·t
+ * separately allocated EC_POINTs. Sender-major: row j holds 𝜙_j_0 ..
+ * 𝜙_j_(t-1) back to back and starts on a cache line. Column k, e.g. the 𝜙_j_0
+ * that add up to the group key, is the points at commit_store_point(s, 0, k)
+ * spaced s->stride bytes apart. Publishing checks that a row decodes; after
+ * that points are decoded only where they enter a computation, straight from
+ * their place in the matrix (msm_encoded). A published row never changes.
+ * One thread fills the store; once participants read it nothing more is
+ * published, and any number of threads may read.
+ *
+ * The store has its own arena and is reference counted: each participant
+ * holding it has a reference, and the last release frees it.
+ */
+#define COMMIT_STORE_ALIGN 64
+
+typedef struct {
+  session_arena* arena;
+  size_t rows;       // one per sender index
+  size_t threshold;  // points per row
+  size_t stride;     // bytes per row, a multiple of COMMIT_STORE_ALIGN
+  uint8_t* data;
+  presence_map published;
+  size_t refs;
+} commit_store;
+
+// An empty store for participants × threshold commitments, one reference
+commit_store* commit_store_new(size_t participants, size_t threshold);
+
+commit_store* commit_store_retain(commit_store* store);
+
+void commit_store_release(commit_store* store);
+
+/* Publishes the row of sender_index: commit_len encoded points. False if the
+ * row has the wrong length, holds an invalid point or is published already. */
+bool commit_store_publish(commit_store* store, int sender_index,
+                          const uint8_t* commit, size_t commit_len,
+                          frost_ctx* ctx);
+
+// The encoded row of sender_index, NULL if it is not published
+const uint8_t* commit_store_row(const commit_store* store, int sender_index);
+
+// 𝜙_row_k, encoded
+const uint8_t* commit_store_point(const commit_store* store, size_t row,
+                                  size_t k);
+
+#endif
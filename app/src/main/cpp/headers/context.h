@@ -0,0 +1,36 @@
+#ifndef FROST_CONTEXT
+#define FROST_CONTEXT
+
+#include "../boringssl/include/openssl/bn.h"
+#include "../boringssl/include/openssl/ec.h"
+
+#include "drbg.h"
+
+/*
+ * Everything an operation needs besides its inputs: the curve, a BN_CTX, the
+ * MSM scratch pool and a random generator.
+ *
+ * The group is BoringSSL's static P-256 object, generator tables included,
+ * so contexts are cheap to make. The BN_CTX and the scratch pool grow to the
+ * largest operation seen and are then reused, so a context kept across calls
+ * makes them allocation-free. A context belongs to one thread at a time.
+ * frost_thread_ctx gives every thread its own, created on first use and
+ * freed when the thread exits.
+ */
+typedef struct msm_scratch msm_scratch;  // msm.h
+
+typedef struct {
+  const EC_GROUP* group;
+  BN_CTX* bn;
+  msm_scratch* scratch;
+  scalar_drbg* rng;
+} frost_ctx;
+
+frost_ctx* frost_ctx_new();
+
+void frost_ctx_free(frost_ctx* ctx);
+
+// The calling thread's context; NULL only if it could not be created
+frost_ctx* frost_thread_ctx();
+
+#endif
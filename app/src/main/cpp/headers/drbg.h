@@ -0,0 +1,34 @@
+#ifndef SCALAR_DRBG
+#define SCALAR_DRBG
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "scalar.h"
+
+/*
+ * CTR_DRBG for secret scalars and batch weights, owned by a frost_ctx
+ * (context.h) and so by one thread at a time.
+ *
+ * A generator is seeded from the system RNG (RAND_bytes) when created and
+ * reseeded every DRBG_RESEED_INTERVAL generate calls. A fork in the process
+ * makes every generator reseed before its next output, so parent and child
+ * never share a stream.
+ */
+#define DRBG_RESEED_INTERVAL 4096
+
+typedef struct scalar_drbg scalar_drbg;
+
+scalar_drbg* drbg_new();
+
+void drbg_free(scalar_drbg* rng);
+
+// Fills out with len random bytes; false if the generator failed
+bool random_bytes(scalar_drbg* rng, uint8_t* out, size_t len);
+
+/* Fills out with count uniform scalars modulo n. Each one is reduced from 64
+ * random bytes (scalar_from_wide), so there is no modulo bias. */
+bool random_scalars(scalar_drbg* rng, scalar* out, size_t count);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef GROUP_OPERATIONS
+#define GROUP_OPERATIONS
+
+#include "../boringssl/include/openssl/bn.h"
+#include "../boringssl/include/openssl/ec.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "context.h"
+#include "scalar.h"
+
+/*
+ * Group operations on P-256, the group of the frost_ctx (context.h).
+ *
+ * group_base_mul is the fixed-base path: scalar multiples of the generator go
+ * through BoringSSL's generator-only entry point, which uses its precomputed,
+ * constant-time comb table for P-256 rather than a generic ladder. All
+ * functions take a caller-owned context so that loops reuse its BN_CTX.
+ */
+
+// Points need no context: every frost_ctx shares BoringSSL's static P-256
+EC_POINT* group_point_new();
+
+EC_POINT* group_point_dup(const EC_POINT* p);
+
+// out = k * G
+bool group_base_mul(EC_POINT* out, const scalar* k, frost_ctx* ctx);
+
+// out[i] = k[i] * G for a whole vector (commitments, nonce commitments)
+bool group_base_mul_batch(EC_POINT** out, const scalar* k, size_t count,
+                          frost_ctx* ctx);
+
+// out = k * P
+bool group_mul(EC_POINT* out, const EC_POINT* p, const scalar* k,
+               frost_ctx* ctx);
+
+// out = a * G + b * P
+bool group_double_mul(EC_POINT* out, const scalar* a, const EC_POINT* p,
+                      const scalar* b, frost_ctx* ctx);
+
+#endif
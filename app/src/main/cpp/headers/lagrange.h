@@ -0,0 +1,36 @@
+#ifndef LAGRANGE_COEFFICIENTS
+#define LAGRANGE_COEFFICIENTS
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "scalar.h"
+
+/*
+ * λ_i = ∏_{j≠i} x_j / (x_j - x_i) for the identifiers x_i (setup.h) of every
+ * index of a signer set, written to lambdas[i]. The whole vector costs a
+ * single field inversion. Returns false for an empty set, a negative index or
+ * a repeated index.
+ */
+bool lagrange_coefficients(const int* indices, size_t count, scalar* lambdas);
+
+/*
+ * Process-wide LRU cache of λ vectors, keyed by the sorted signer index set,
+ * so a signer set that signs again costs no Lagrange work. Safe to call from
+ * several threads; at most LAGRANGE_CACHE_CAPACITY sets are kept.
+ */
+#define LAGRANGE_CACHE_CAPACITY 64
+
+// Same contract as lagrange_coefficients, served from the cache when possible
+bool lagrange_cache_get(const int* indices, size_t count, scalar* lambdas);
+
+// λ for one member of the set
+bool lagrange_cache_coefficient(const int* indices, size_t count, int index,
+                                scalar* lambda);
+
+void lagrange_cache_stats(uint64_t* hits, uint64_t* misses);
+
+void lagrange_cache_clear();
+
+#endif
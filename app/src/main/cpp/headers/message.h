@@ -0,0 +1,56 @@
+#ifndef MESSAGE_SOURCE
+#define MESSAGE_SOURCE
+
+#include "../boringssl/include/openssl/sha.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * A message to be signed or verified, read once front to back into a digest.
+ * Large artifacts are never held in memory as a whole: a mapped file is
+ * hashed in windows whose pages are dropped behind the digest, and fd and
+ * callback sources go through one fixed-size buffer.
+ */
+
+// Fills buf with up to len bytes; returns the count, 0 at the end, -1 on error
+typedef ssize_t (*message_read_fn)(void* arg, uint8_t* buf, size_t len);
+
+typedef enum {
+  MESSAGE_BUFFER,
+  MESSAGE_MAPPED,
+  MESSAGE_FD,
+  MESSAGE_CALLBACK
+} message_kind;
+
+typedef struct {
+  message_kind kind;
+  const uint8_t* data;  // MESSAGE_BUFFER and MESSAGE_MAPPED
+  size_t size;
+  int fd;               // MESSAGE_FD, read from its current offset
+  off_t start;          // MESSAGE_FD: that offset, -1 if fd cannot seek
+  message_read_fn read; // MESSAGE_CALLBACK
+  void* arg;
+} message_source;
+
+message_source message_from_buffer(const uint8_t* data, size_t size);
+
+message_source message_from_fd(int fd);
+
+message_source message_from_callback(message_read_fn read, void* arg);
+
+// Maps a regular file read-only; release with message_release
+bool message_map_fd(int fd, message_source* out);
+
+void message_release(message_source* m);
+
+/* Positions the source at its first byte again, so it can be absorbed a
+ * second time. Pipes, sockets and callbacks cannot rewind. */
+bool message_rewind(const message_source* m);
+
+/* SHA256_Update with the whole message. Returns the number of bytes
+ * absorbed in *size; false if the source failed part way. */
+bool message_absorb(SHA256_CTX* sha, const message_source* m, uint64_t* size);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef MULTI_SCALAR_MULTIPLICATION
+#define MULTI_SCALAR_MULTIPLICATION
+
+#include "../boringssl/include/openssl/bn.h"
+#include "../boringssl/include/openssl/ec.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "context.h"
+#include "scalar.h"
+
+/*
+ * out = Σ scalars[i] * points[i]
+ *
+ * Straus (interleaved 4-bit windows) below MSM_PIPPENGER_THRESHOLD points,
+ * Pippenger bucket accumulation above it. Runs in variable time, so it is
+ * meant for verification equations over public scalars only; secret scalars
+ * go through group_base_mul / group_mul.
+ */
+#define MSM_PIPPENGER_THRESHOLD 128
+
+/* Reusable pool of temporary points and recoded scalars, kept in the
+ * frost_ctx; grows to the largest MSM seen and is then reused without further
+ * allocation. */
+typedef struct msm_scratch {
+  size_t cap;
+  EC_POINT** pool;
+  size_t limbs_cap;
+  uint64_t (*limbs)[4];
+  size_t decoded_cap;
+  EC_POINT** decoded;  // msm_encoded's inputs
+} msm_scratch;
+
+msm_scratch* msm_scratch_new();
+
+void msm_scratch_free(msm_scratch* scratch);
+
+bool msm(EC_POINT* out, const EC_POINT* const* points, const scalar* scalars,
+         size_t count, frost_ctx* ctx);
+
+/* msm over encoded points (SEC1, point_bytes each) read in place, e.g. from
+ * a commitment matrix; they are decoded into the scratch pool. False if one
+ * of them is not a valid point. */
+bool msm_encoded(EC_POINT* out, const uint8_t* const* points,
+                 size_t point_bytes, const scalar* scalars, size_t count,
+                 frost_ctx* ctx);
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef NONCE_PREPROCESSING
+#define NONCE_PREPROCESSING
+
+#include "../boringssl/include/openssl/bn.h"
+#include "../boringssl/include/openssl/ec.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "context.h"
+#include "scalar.h"
+
+/*
+ * Single-use store of FROST preprocessing nonces, one per participant.
+ *
+ * Pair j holds the hiding nonce d_j and the binding nonce e_j, and the
+ * commitments D_j = G ^ d_j and E_j = G ^ e_j published under id j. Ids are
+ * handed out in order and never reused. nonce_store_take marks a pair used
+ * and erases it as it hands it out, so no pair can sign twice.
+ *
+ * A store lives in memory (nonce_store_new) or in a file mapped with
+ * nonce_store_open, where it survives restarts:
+ *
+ *   - pairs and commitments reach the disk before the published count moves
+ *     past them, so a crash while generating only loses unpublished pairs;
+ *   - the used marker of a pair is set with an atomic compare-and-swap in the
+ *     shared mapping and synced before the pair is returned, so a crash can
+ *     lose a pair but never hand it out twice, even to another process
+ *     mapping the same file.
+ *
+ * Reopening a file costs one mmap and one scan of the markers; the unused
+ * commitments can be republished without any scalar multiplication.
+ */
+
+// pairs a store holds when a participant first preprocesses
+#define NONCE_STORE_CAPACITY 1024
+
+// uncompressed SEC1 points: loading them back needs no square root
+#define NONCE_POINT_BYTES 65
+
+typedef struct nonce_file_header nonce_file_header;
+
+typedef struct {
+  size_t capacity;
+  size_t generated;  // pairs [0, generated) exist
+  size_t remaining;  // generated and not yet taken, as seen by this handle
+  scalar* hiding;
+  scalar* binding;
+  uint8_t (*commitments)[2][NONCE_POINT_BYTES];  // D_j, E_j
+  uint8_t* used;
+
+  // file-backed stores only
+  int fd;
+  uint8_t* map;
+  size_t map_size;
+  nonce_file_header* header;
+} nonce_store;
+
+nonce_store* nonce_store_new(size_t capacity);
+
+/* Maps the store at path, creating it with room for capacity pairs if it
+ * does not exist; an existing file keeps its own capacity. NULL if the file
+ * cannot be created or is not a store of this version. */
+nonce_store* nonce_store_open(const char* path, size_t capacity);
+
+/* Erases every pair still held by an in-memory store. A file-backed store is
+ * only unmapped: its unused pairs stay valid for the next open. */
+void nonce_store_free(nonce_store* store);
+
+/* Draws count fresh pairs in one call and commits to them; their ids are
+ * first_id onwards. False if the store has no room for count more pairs. */
+bool nonce_store_generate(nonce_store* store, size_t count, uint32_t* first_id,
+                          frost_ctx* ctx);
+
+// The published commitments of pair id, whether or not it was taken
+bool nonce_store_commitment(const nonce_store* store, uint32_t id,
+                            EC_POINT* hiding, EC_POINT* binding,
+                            frost_ctx* ctx);
+
+/* Pairs generated so far, by this handle or, for a file, by any process
+ * mapping it: ids below it exist */
+size_t nonce_store_published(const nonce_store* store);
+
+/* True once pair id was taken, by this handle or another one on the file;
+ * false for an id not generated yet */
+bool nonce_store_is_used(const nonce_store* store, uint32_t id);
+
+/* Moves pair id out of the store for signing. False if the id was never
+ * generated, was already taken, or its marker could not be made durable. */
+bool nonce_store_take(nonce_store* store, uint32_t id, scalar* hiding,
+                      scalar* binding);
+
+#endif
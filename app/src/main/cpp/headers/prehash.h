@@ -0,0 +1,39 @@
+#ifndef MESSAGE_PREHASH
+#define MESSAGE_PREHASH
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "message.h"
+
+/*
+ * Prehash mode for multi-gigabyte payloads, version 1.
+ *
+ * The message is cut into PREHASH_CHUNK-byte chunks (the last one may be
+ * shorter; an empty message is one empty chunk). Leaves and inner nodes are
+ *
+ *   leaf = SHA-256(0x00 || chunk)      node = SHA-256(0x01 || left || right)
+ *
+ * combined level by level, an unpaired last node moving up unchanged. Leaves
+ * are hashed in parallel, so the cost scales with the number of cores.
+ *
+ * What gets signed in place of the message is the PREHASH_BYTES encoding
+ *
+ *   PREHASH_TAG || chunk size (u64 BE) || message length (u64 BE) || root
+ *
+ * Signer and verifier must both use the mode explicitly; the tag and the
+ * version in it keep the encoding apart from later layouts. The signature
+ * itself is hashed under a context string of its own (SIGNING_PREHASHED in
+ * signing.h), so it is never also a raw signature of these bytes.
+ */
+#define PREHASH_TAG "FROST-P256-SHA256-v1 merkle-prehash-v1"
+#define PREHASH_TAG_LEN (sizeof(PREHASH_TAG) - 1)
+#define PREHASH_CHUNK (1 << 20)
+#define PREHASH_BYTES (PREHASH_TAG_LEN + 8 + 8 + 32)
+
+// threads below 2 hash on the calling thread
+bool prehash_message(const message_source* m, int threads,
+                     uint8_t out[PREHASH_BYTES]);
+
+#endif
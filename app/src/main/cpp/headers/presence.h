@@ -0,0 +1,34 @@
+#ifndef PRESENCE_MAP
+#define PRESENCE_MAP
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+/*
+ * One bit per sender index: which slots of an index-addressed array of
+ * received packets hold a packet. Walking the senders that did send costs one
+ * word per 64 senders, and count answers "has everyone sent?" directly.
+ */
+typedef struct {
+  uint64_t* words;
+  size_t size;   // slots 0 ≤ i < size
+  size_t count;  // bits set
+} presence_map;
+
+// size clear bits, from the arena
+bool presence_init(presence_map* map, session_arena* arena, size_t size);
+
+bool presence_test(const presence_map* map, size_t i);
+
+// Sets bit i; false if i is out of range or already set
+bool presence_add(presence_map* map, size_t i);
+
+// The first set bit at or after i, map->size if there is none
+size_t presence_next(const presence_map* map, size_t i);
+
+void presence_clear(presence_map* map);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef SCALAR_ARITHMETIC
+#define SCALAR_ARITHMETIC
+
+#include "../boringssl/include/openssl/bn.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Fixed-width integer modulo the P-256 group order n.
+ *
+ * The four 64-bit limbs are little-endian and always hold the value in
+ * Montgomery form (a * 2^256 mod n), fully reduced. Scalars live on the stack
+ * or inline in protocol structs; none of the functions below allocate.
+ */
+typedef struct {
+  uint64_t v[4];
+} scalar;
+
+#define SCALAR_BYTES 32
+
+void scalar_zero(scalar* r);
+
+void scalar_one(scalar* r);
+
+void scalar_set_word(scalar* r, uint64_t w);
+
+bool scalar_is_zero(const scalar* a);
+
+bool scalar_equal(const scalar* a, const scalar* b);
+
+void scalar_add(scalar* r, const scalar* a, const scalar* b);
+
+void scalar_sub(scalar* r, const scalar* a, const scalar* b);
+
+void scalar_neg(scalar* r, const scalar* a);
+
+void scalar_mul(scalar* r, const scalar* a, const scalar* b);
+
+void scalar_sqr(scalar* r, const scalar* a);
+
+// r = a^e for a public exponent e
+void scalar_pow_word(scalar* r, const scalar* a, uint64_t e);
+
+// r = a^-1 (Fermat, a^(n-2)); the inverse of zero is zero
+void scalar_inv(scalar* r, const scalar* a);
+
+// 32 big-endian bytes, reduced modulo n
+void scalar_from_bytes(scalar* r, const uint8_t in[SCALAR_BYTES]);
+
+// 64 big-endian bytes, reduced modulo n; unbiased for uniform input
+void scalar_from_wide(scalar* r, const uint8_t in[2 * SCALAR_BYTES]);
+
+void scalar_to_bytes(uint8_t out[SCALAR_BYTES], const scalar* a);
+
+// Canonical (non-Montgomery) little-endian limbs, for window recoding
+void scalar_to_limbs(uint64_t out[4], const scalar* a);
+
+// Any non-negative BIGNUM, reduced modulo n
+bool scalar_from_bn(scalar* r, const BIGNUM* bn);
+
+bool scalar_to_bn(const scalar* a, BIGNUM* out);
+
+void scalar_cleanse(scalar* a);
+
+#endif
@@ -2,86 +2,143 @@
 #define PARTICIPANT_ATRIBUTES
 
 #include "../boringssl/include/openssl/bn.h"
+#include "../boringssl/include/openssl/ec.h"
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "commit_encoding.h"
+#include "commit_store.h"
+#include "context.h"
+#include "nonce.h"
+#include "presence.h"
+#include "scalar.h"
+#include "signer_set.h"
 
 typedef struct participant participant;  // Forward declaration
 
 typedef struct {
   size_t coefficient_list_len;
-  BIGNUM** coeff;
+  scalar* coeff;
 } coeff_list;
 
+/* A dealer's commitments 𝜙_j_0 .. 𝜙_j_(t-1), commit_len encoded points of
+ * COMMIT_POINT_BYTES back to back, as one row of a commit_store */
 typedef struct {
   int sender_index;
   size_t commit_len;
-  BIGNUM** commit;
+  const uint8_t* commit;
 } pub_commit_packet;
 
+/* One preprocessed nonce commitment (D, E) of a participant, published
+ * ahead of signing under the id of its pair in the sender's nonce store */
 typedef struct {
   int sender_index;
-  BIGNUM* verify_share;
-  BIGNUM* pub_share;
-  BIGNUM* public_key;
+  uint32_t nonce_id;
+  EC_POINT* verify_share;
+  EC_POINT* pub_share;      // hiding commitment D = G ^ d
+  EC_POINT* binding_share;  // binding commitment E = G ^ e
+  EC_POINT* public_key;
 } pub_share_packet;
 
 typedef struct {
-  BIGNUM* coefficient;
-  BIGNUM* exponent;
-} term;
-
-typedef struct {
-  int n;
-  term* t;
-} poly;
-
-typedef struct node_commit {
-  struct node_commit* next;
-  pub_commit_packet* rcvd_packet;
-} rcvd_pub_commits;
-
-typedef struct node_share {
-  struct node_share* next;
-  BIGNUM* rcvd_share;
-} rcvd_sec_shares;
-
-typedef struct {
-  char* m;
-  size_t m_size;
-  BIGNUM* R;
-  participant* S;
-  size_t S_size;
+  size_t m_size;  // the payload itself is never copied into a tuple
+  EC_POINT* R;
+  signer_set S;  // indices only, ascending: the order of every array below
+
+  /* Commitment list: the nonce pair each signer uses and its commitments
+   * D and E */
+  uint32_t* nonce_ids;
+  EC_POINT** hiding;
+  EC_POINT** binding;
+
+  /* Session memo, derived once by init_tuple_packet and read-only after:
+   * c = H2(R, Y, m) and, in S order, the signers' λ and their binding
+   * factors ρ. The aggregator sends them, but a signer's copy holds only what
+   * init_sig_share derives again from the commitment list. */
+  scalar challenge;
+  scalar* lambda;
+  scalar* rho;
 } tuple_packet;
 
 struct participant {
+  session_arena* arena;  // source of every session object the participant holds
   int index;
   int threshold;
   int participants;
-  BIGNUM* secret_share;
-  BIGNUM* verify_share;
-  BIGNUM* public_key;
-  BIGNUM* nonce;
+  scalar secret_share;
+  EC_POINT* verify_share;
+  EC_POINT* public_key;
+  nonce_store* nonces;
   coeff_list* list;
   pub_commit_packet* pub_commit;
-  poly* func;
-  rcvd_pub_commits* rcvd_commit_head;
-  rcvd_sec_shares* rcvd_sec_share_head;
-  pub_share_packet* pub_share;
+
+  /* Every dealer's commitments, the participant's own included: a store
+   * shared with the other local participants, or a private one filled by
+   * accept_pub_commit. A reference is held until the keys exist. */
+  commit_store* commits;
+
+  // Shares received, one slot per sender index, allocated on the first one
+  scalar* rcvd_sec_shares;
+  presence_map sec_shares_in;
   tuple_packet* rcvd_tuple;
+
+  /* Optional: accept_tuple copies each tuple here, rewinding it first, so
+   * signing session after session reuses the same memory */
+  session_arena* session;
 };
 
+/*
+ * Participant index i is the point x_i = i + 1 of every share polynomial, its
+ * FROST identifier: x = 0 is where the secret lies, and RFC 9591 forbids the
+ * identifier 0. Shares, their checks and λ all use it.
+ */
+uint64_t participant_identifier(int index);
+
 /*Pedersen Distributed Key Generation*/
 
-pub_commit_packet* init_pub_commit(participant* p);
+pub_commit_packet* init_pub_commit(participant* p, frost_ctx* ctx);
 
-void free_pub_commit(pub_commit_packet* pub_commit);
+/* A commitment from a remote dealer, validated and kept in the receiver's
+ * private store (created with the first one, holding its own commitment) */
+bool accept_pub_commit(participant* reciever, pub_commit_packet* pub_commit,
+                       frost_ctx* ctx);
 
-bool accept_pub_commit(participant* reciever, pub_commit_packet* pub_commit);
+// Publishes a dealer's commitment once into a store shared by local parties
+bool publish_pub_commit(commit_store* store, const pub_commit_packet* pub_commit,
+                        frost_ctx* ctx);
 
-BIGNUM* init_sec_share(participant* sender, int reciever_index);
+/* The receiver reads every commitment from store, which is then complete,
+ * instead of accepting them one by one; it takes a reference */
+bool accept_commit_store(participant* reciever, commit_store* store);
 
-bool accept_sec_share(participant* reciever, int sender_index,
-                      BIGNUM* sec_share);
+bool init_sec_share(participant* sender, int reciever_index,
+                    scalar* sec_share);
 
-void gen_keys(participant* p);
+/* Evaluates the dealer's polynomial at every receiver index in one call and
+ * returns the shares as one contiguous array in the sender's arena, shares[i]
+ * for reciever_indices[i]. Wipe it with free_sec_shares once sent. */
+scalar* init_sec_shares(participant* sender, const int* reciever_indices,
+                        size_t count);
+
+void free_sec_shares(scalar* shares, size_t count);
+
+bool accept_sec_share(participant* reciever, int sender_index,
+                      const scalar* sec_share, frost_ctx* ctx);
+
+/* Batch mode: store_sec_share only records the share, and refuses a second
+ * one from the same dealer. Once every dealer's share and commitment has
+ * arrived, verify_sec_shares checks all of them with one randomised
+ * multi-exponentiation. If that fails it re-checks dealer by dealer and lists
+ * the cheating senders in blamed, which needs room for one entry per
+ * participant. A dealer whose share is missing fails the check and is blamed
+ * too. */
+bool store_sec_share(participant* reciever, int sender_index,
+                     const scalar* sec_share);
+
+bool verify_sec_shares(participant* reciever, int* blamed,
+                       size_t* blamed_count, frost_ctx* ctx);
+
+void gen_keys(participant* p, frost_ctx* ctx);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef SHA256_MULTI_BUFFER
+#define SHA256_MULTI_BUFFER
+
+#include "../boringssl/include/openssl/sha.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Many independent SHA-256 digests at once.
+ *
+ * On x86-64 CPUs with AVX2 and without the SHA extensions, eight lanes go
+ * through one vectorised compression per block. Everywhere else (arm64 with
+ * its SHA-2 instructions, x86-64 with SHA-NI) the lanes are hashed one after
+ * the other through SHA256_TransformBlocks, which already uses the hardware.
+ *
+ * A lane hashes the concatenation of up to SHA256_LANE_PARTS pieces, so
+ * callers need not copy points, payload and suffix into one buffer. It may
+ * start from a midstate shared by many lanes (sha256_lane_absorb).
+ */
+#define SHA256_LANE_PARTS 4
+
+typedef struct {
+  uint32_t h[8];        // chaining value, the IV after sha256_lane_init
+  uint64_t prefix_len;  // bytes already in h, a multiple of SHA256_CBLOCK
+  const uint8_t* part[SHA256_LANE_PARTS];
+  size_t part_len[SHA256_LANE_PARTS];
+  int parts;
+  uint8_t* out;         // SHA256_DIGEST_LENGTH bytes
+} sha256_lane;
+
+void sha256_lane_init(sha256_lane* lane, uint8_t* out);
+
+// Compresses whole blocks into the lane's chaining value right away
+void sha256_lane_absorb(sha256_lane* lane, const uint8_t* blocks,
+                        size_t num_blocks);
+
+// Appends a piece of the message; false if the lane has no part left
+bool sha256_lane_add(sha256_lane* lane, const void* data, size_t len);
+
+// Finishes every lane, writing its digest to lane->out
+void sha256_lanes(sha256_lane* lanes, size_t count);
+
+// Lanes hashed per compression: 8 with the AVX2 kernel, 1 otherwise
+int sha256_lanes_width();
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef SIGNER_SET
+#define SIGNER_SET
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+#include "presence.h"
+
+/*
+ * The signers of a session by participant index alone: the indices sorted
+ * ascending, which is the order of every per-signer array of a tuple, and a
+ * bitset over all participant indices for membership in O(1). Nothing of a
+ * participant is copied, its shares least of all.
+ */
+typedef struct {
+  int* indices;
+  size_t size;
+  presence_map members;  // bit i set for every signer i
+} signer_set;
+
+/* The set of the count indices, from the arena. False if an index is outside
+ * 0 ≤ i < participants or appears twice. */
+bool signer_set_init(signer_set* set, session_arena* arena, const int* indices,
+                     size_t count, size_t participants);
+
+// A copy of in held by another arena, e.g. a receiver's
+bool signer_set_dup(signer_set* out, session_arena* arena,
+                    const signer_set* in);
+
+bool signer_set_contains(const signer_set* set, int index);
+
+// The position of index in set->indices, -1 if it is not a signer
+int signer_set_position(const signer_set* set, int index);
+
+#endif
@@ -1,49 +1,173 @@
 #include "../boringssl/include/openssl/bn.h"
+#include "../boringssl/include/openssl/ec.h"
 #include <stdbool.h>
 
+#include "arena.h"
+#include "context.h"
+#include "message.h"
+#include "presence.h"
+#include "scalar.h"
 #include "setup.h"
 
-typedef struct node_pub_share {
-  pub_share_packet* rcvd_packets;
-  struct node_pub_share* next;
-} rcvd_pub_shares;
+/* What the hashes of a signature are domain-separated by: raw messages, or
+ * the encoding of prehash_message (prehash.h), which has its own context
+ * string. A signature made in one mode never verifies in the other. */
+typedef enum {
+  SIGNING_RAW,
+  SIGNING_PREHASHED
+} signing_mode;
 
-typedef struct node_sig_share {
-  BIGNUM* rcvd_share;
-  struct node_sig_share* next;
-} rcvd_sig_shares;
+/* Pooled commitments of one sender, oldest first: packets[first] up to
+ * packets[count - 1] are unused. A full queue moves its unused packets to a
+ * larger array; taken ones stay put for the sessions that use them. */
+typedef struct {
+  pub_share_packet* packets;
+  size_t first;
+  size_t count;
+  size_t capacity;
+} pub_share_queue;
 
 typedef struct {
     BIGNUM * signature;
     BIGNUM * hash;
+    EC_POINT* R;  // group commitment, needed for batch verification
     char* m;
 } signature_packet;
 
 
 typedef struct {
+  session_arena* arena;  // source of every object the aggregator holds
   int threshold;
-  BIGNUM* public_key;
-  BIGNUM* R_pub_commit;
-  BIGNUM* hash;
+  int participants;      // sender indices run from 0 to participants - 1
+  EC_POINT* public_key;
+  EC_POINT* R_pub_commit;
+  scalar hash;
   tuple_packet* tuple;
-  rcvd_pub_shares* rcvd_pub_share_head;
-  rcvd_sig_shares* rcvd_sig_shares_head;
+  pub_share_queue* pool;               // unused commitments, by sender index
+  pub_share_packet** session_shares;   // taken by the tuple, in S order
+  scalar* rcvd_sig_shares;             // responses, by sender index
+  presence_map sig_shares_in;
+
+  /* Optional: the tuple, R and the checks' scratch come from here instead,
+   * and every new tuple rewinds it, so after a warm-up session signing with
+   * the same signer count reuses its memory; the steady_state_signing test
+   * (tests/) fails if such a session allocates. */
+  session_arena* session;
 } aggregator;
 
-pub_share_packet* init_pub_share(participant* p);
+/* Gives p the file-backed nonce store at path (nonce.h), created with
+ * NONCE_STORE_CAPACITY pairs if it does not exist, so its nonces survive a
+ * restart. Call it before the first preprocessing; false if p already has a
+ * store or the file cannot be opened. */
+bool attach_nonce_store(participant* p, const char* path);
+
+/*
+ * Preprocessing: count fresh (d, e) pairs go into the participant's nonce
+ * store and their commitments come back as packets, allocated in its arena,
+ * to publish ahead of any signing. Each tuple then takes one pooled
+ * commitment per signer, so signing itself is a single round. Without an
+ * attached store, the first call creates one in memory.
+ */
+pub_share_packet* init_pub_shares(participant* p, size_t count,
+                                  frost_ctx* ctx);
+
+// A batch of one
+pub_share_packet* init_pub_share(participant* p, frost_ctx* ctx);
+
+/* Packets for every pair of p's nonce store not taken yet, e.g. after
+ * attaching its file again (attach_nonce_store) on restart: the stored
+ * commitments are loaded, nothing is recomputed. */
+pub_share_packet* republish_pub_shares(participant* p, size_t* count,
+                                       frost_ctx* ctx);
 
 bool accept_pub_share(aggregator* receiver, pub_share_packet* packet);
 
+// Drops the commitments no session has used
+void free_pub_share_pool(aggregator* a);
+
+/* set names the signers by index, in any order; the tuple holds them as a
+ * signer_set and no participant is copied. The message m is hashed where it
+ * is, as init_tuple_packet_stream does with a buffer source. */
 tuple_packet* init_tuple_packet(aggregator* a, char* m, size_t m_size,
-                                participant* set, int set_size);
+                                const int* set, int set_size,
+                                frost_ctx* ctx);
+
+/* Same tuple for a message streamed from m, hashed in the domain of mode.
+ * The payload is hashed and not copied: the tuple carries only its length.
+ * Binding factors need the message before R and the challenge after it, so
+ * m is read twice and must rewind (a buffer, a mapped file or a seekable
+ * fd); otherwise NULL is returned. For pipes and callbacks, sign the
+ * prehash_message encoding in SIGNING_PREHASHED mode instead. */
+tuple_packet* init_tuple_packet_stream(aggregator* a, const message_source* m,
+                                       signing_mode mode, const int* set,
+                                       int set_size, frost_ctx* ctx);
 
+/* A copy of the signer set and commitment list of packet for receiver, in
+ * its session arena if it has one. What the aggregator derived from them is
+ * left behind. */
 bool accept_tuple(participant* receiver, tuple_packet* packet);
 
-BIGNUM* init_sig_share(participant* p);
+/* The response of p to its accepted tuple, for the message m it means to
+ * sign in mode. Checks that the tuple names p's own commitments, then
+ * derives ρ, R, c and λ itself from the commitment list, Y and m, so an
+ * aggregator cannot steer them; m is read twice and must rewind. */
+bool init_sig_share(participant* p, const message_source* m,
+                    signing_mode mode, scalar* sig_share, frost_ctx* ctx);
+
+bool accept_sig_share(aggregator* receiver, const scalar* sig_share,
+                      int sender_index, frost_ctx* ctx);
+
+/* Batch mode: store_sig_share only records the response, and refuses senders
+ * outside S and repeats. verify_sig_shares then checks all t responses with
+ * one randomised combined equation and, only if that fails, re-checks them
+ * one by one and lists in blamed (room for one entry per signer) every signer
+ * whose response is invalid or missing. */
+bool store_sig_share(aggregator* receiver, const scalar* sig_share,
+                     int sender_index);
 
-bool accept_sig_share(aggregator* receiver, BIGNUM* sig_share,
-                      int sender_index);
+bool verify_sig_shares(aggregator* receiver, int* blamed,
+                       size_t* blamed_count, frost_ctx* ctx);
 
 signature_packet signature(aggregator* a);
 
-bool verify_signature(char* signature_hex, char* hash_hex, char* m, BIGNUM* Y);
\ No newline at end of file
+/* The same signature written into sig, whose BIGNUMs and R are reused when
+ * set and created otherwise: signing into one packet over and over does not
+ * allocate */
+bool signature_into(aggregator* a, signature_packet* sig);
+
+/* c = H2(R || Y || m) as in FROST(P-256, SHA-256): compressed points and the
+ * raw message bytes streamed into expand_message_xmd, 48 bytes reduced modulo
+ * the order. Fails for an identity R or Y. This and the other hash_func
+ * variants hash in SIGNING_RAW mode. */
+bool hash_func(scalar* out, const EC_POINT* R, const EC_POINT* Y,
+               const uint8_t* m, size_t m_size);
+
+typedef struct {
+  const EC_POINT* R;
+  const EC_POINT* Y;
+  const uint8_t* m;
+  size_t m_size;
+} challenge_input;
+
+/* hash_func for count independent inputs, e.g. a batch of signatures to
+ * verify. The short hashes are computed several at a time with the
+ * multi-buffer SHA-256 of sha256_multi.h. ok[i] tells whether out[i] was
+ * set: false for a NULL or identity point. True if every input hashed. */
+bool hash_func_batch(scalar* out, bool* ok, const challenge_input* in,
+                     size_t count);
+
+// hash_func over a streamed message; its length goes to m_size if not NULL
+bool hash_func_stream(scalar* out, const EC_POINT* R, const EC_POINT* Y,
+                      const message_source* m, uint64_t* m_size);
+
+bool verify_signature(char* signature_hex, char* hash_hex, char* m,
+                      const EC_POINT* Y, frost_ctx* ctx);
+
+bool verify_signature_stream(char* signature_hex, char* hash_hex,
+                             const message_source* m, const EC_POINT* Y,
+                             frost_ctx* ctx);
+
+// Verifier for SIGNING_PREHASHED signatures of prehash_message(m) (prehash.h)
+bool verify_signature_prehashed(char* signature_hex, char* hash_hex,
+                                const message_source* m, int threads,
+                                const EC_POINT* Y, frost_ctx* ctx);
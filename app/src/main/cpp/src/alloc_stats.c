@@ -0,0 +1,128 @@
+#include "../headers/alloc_stats.h"
+
+#include <malloc.h>
+#include <pthread.h>
+#include <stddef.h>
+
+static alloc_counters counters[ALLOC_PHASE_COUNT];
+static uint64_t live;  // bytes allocated and not freed yet
+
+// the phase of each thread, stored as the key's value: none means IDLE
+static pthread_key_t phase_key;
+static pthread_once_t phase_once = PTHREAD_ONCE_INIT;
+static bool phase_key_ready;
+
+static void init_phase_key() {
+  __atomic_store_n(&phase_key_ready,
+                   pthread_key_create(&phase_key, NULL) == 0,
+                   __ATOMIC_RELEASE);
+}
+
+static alloc_phase current_phase() {
+  if (!__atomic_load_n(&phase_key_ready, __ATOMIC_ACQUIRE)) {
+    return ALLOC_PHASE_IDLE;
+  }
+  return (alloc_phase)(uintptr_t)pthread_getspecific(phase_key);
+}
+
+alloc_phase alloc_phase_enter(alloc_phase phase) {
+  pthread_once(&phase_once, init_phase_key);
+  alloc_phase previous = current_phase();
+  if (phase_key_ready) {
+    pthread_setspecific(phase_key, (void*)(uintptr_t)phase);
+  }
+  return previous;
+}
+
+void alloc_stats_get(alloc_phase phase, alloc_counters* out) {
+  alloc_counters* c = &counters[phase];
+  out->allocs = __atomic_load_n(&c->allocs, __ATOMIC_RELAXED);
+  out->frees = __atomic_load_n(&c->frees, __ATOMIC_RELAXED);
+  out->bytes = __atomic_load_n(&c->bytes, __ATOMIC_RELAXED);
+  out->peak = __atomic_load_n(&c->peak, __ATOMIC_RELAXED);
+}
+
+void alloc_stats_reset() {
+  uint64_t now = __atomic_load_n(&live, __ATOMIC_RELAXED);
+  for (int i = 0; i < ALLOC_PHASE_COUNT; i++) {
+    __atomic_store_n(&counters[i].allocs, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters[i].frees, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters[i].bytes, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters[i].peak, now, __ATOMIC_RELAXED);
+  }
+}
+
+const char* alloc_phase_name(alloc_phase phase) {
+  static const char* const names[ALLOC_PHASE_COUNT] = {
+      "idle", "dkg", "preprocess", "sign", "verify"};
+  return phase < ALLOC_PHASE_COUNT ? names[phase] : "unknown";
+}
+
+#ifdef FROST_ALLOC_STATS
+
+bool alloc_stats_enabled() { return true; }
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+static void charge(size_t size) {
+  alloc_counters* c = &counters[current_phase()];
+  __atomic_add_fetch(&c->allocs, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&c->bytes, size, __ATOMIC_RELAXED);
+
+  uint64_t now = __atomic_add_fetch(&live, size, __ATOMIC_RELAXED);
+  uint64_t peak = __atomic_load_n(&c->peak, __ATOMIC_RELAXED);
+  while (now > peak &&
+         !__atomic_compare_exchange_n(&c->peak, &peak, now, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+}
+
+static void discharge(size_t size) {
+  __atomic_add_fetch(&counters[current_phase()].frees, 1, __ATOMIC_RELAXED);
+  __atomic_sub_fetch(&live, size, __ATOMIC_RELAXED);
+}
+
+void* __wrap_malloc(size_t size) {
+  void* ptr = __real_malloc(size);
+  if (ptr != NULL) {
+    charge(malloc_usable_size(ptr));
+  }
+  return ptr;
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  void* ptr = __real_calloc(count, size);
+  if (ptr != NULL) {
+    charge(malloc_usable_size(ptr));
+  }
+  return ptr;
+}
+
+// counted as a free of the old block and an allocation of the new one
+void* __wrap_realloc(void* ptr, size_t size) {
+  size_t before = ptr != NULL ? malloc_usable_size(ptr) : 0;
+  void* out = __real_realloc(ptr, size);
+  if (ptr != NULL && (out != NULL || size == 0)) {
+    discharge(before);
+  }
+  if (out != NULL) {
+    charge(malloc_usable_size(out));
+  }
+  return out;
+}
+
+void __wrap_free(void* ptr) {
+  if (ptr != NULL) {
+    discharge(malloc_usable_size(ptr));
+  }
+  __real_free(ptr);
+}
+
+#else
+
+bool alloc_stats_enabled() { return false; }
+
+#endif
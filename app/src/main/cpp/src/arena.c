@@ -0,0 +1,240 @@
+#include "../headers/arena.h"
+
+#include "../boringssl/include/openssl/mem.h"
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../headers/group.h"
+
+#define ARENA_ALIGN alignof(max_align_t)
+
+// points tracked per arena_points record
+#define ARENA_POINTS_PER_RECORD 64
+
+struct arena_block {
+  arena_block* next;
+  size_t size;  // usable bytes after the header
+  size_t used;
+  alignas(max_align_t) uint8_t data[];
+};
+
+struct arena_points {
+  arena_points* next;
+  size_t count;
+  EC_POINT* point[ARENA_POINTS_PER_RECORD];
+};
+
+static size_t align_up(size_t n) {
+  return (n + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+// The smallest spare block of at least size bytes, unlinked; NULL if none
+static arena_block* take_spare_block(session_arena* arena, size_t size) {
+  arena_block** best = NULL;
+  for (arena_block** link = &arena->spare_blocks; *link;
+       link = &(*link)->next) {
+    if ((*link)->size >= size && (!best || (*link)->size < (*best)->size)) {
+      best = link;
+    }
+  }
+  if (best == NULL) {
+    return NULL;
+  }
+  arena_block* block = *best;
+  *best = block->next;
+  return block;
+}
+
+static arena_block* new_block(session_arena* arena, size_t size) {
+  arena_block* block = take_spare_block(arena, size);
+  if (block != NULL) {
+    return block;
+  }
+  block = OPENSSL_malloc(sizeof(arena_block) + size);
+  if (block == NULL) {
+    return NULL;
+  }
+  block->size = size;
+  block->used = 0;
+  arena->reserved += size;
+  return block;
+}
+
+session_arena* arena_new() {
+  session_arena* arena = OPENSSL_zalloc(sizeof(session_arena));
+  if (arena == NULL) {
+    return NULL;
+  }
+  arena->blocks = new_block(arena, ARENA_BLOCK_SIZE);
+  if (arena->blocks == NULL) {
+    OPENSSL_free(arena);
+    return NULL;
+  }
+  arena->blocks->next = NULL;
+  return arena;
+}
+
+void* arena_alloc(session_arena* arena, size_t size) {
+  size_t need = align_up(size > 0 ? size : 1);
+  if (need < size) {
+    return NULL;  // overflow
+  }
+
+  arena_block* head = arena->blocks;
+  if (head->size - head->used < need) {
+    if (need > ARENA_BLOCK_SIZE / 4) {
+      // a large object gets its own block behind the head, whose free space
+      // stays in use for small ones
+      arena_block* block = new_block(arena, need);
+      if (block == NULL) {
+        return NULL;
+      }
+      block->used = need;
+      block->next = head->next;
+      head->next = block;
+      arena->used += need;
+      memset(block->data, 0, need);
+      return block->data;
+    }
+    head = new_block(arena, ARENA_BLOCK_SIZE);
+    if (head == NULL) {
+      return NULL;
+    }
+    head->next = arena->blocks;
+    arena->blocks = head;
+  }
+
+  void* out = head->data + head->used;
+  head->used += need;
+  arena->used += need;
+  memset(out, 0, need);
+  return out;
+}
+
+void* arena_dup(session_arena* arena, const void* data, size_t size) {
+  void* out = arena_alloc(arena, size);
+  if (out != NULL && size > 0) {
+    memcpy(out, data, size);
+  }
+  return out;
+}
+
+static EC_POINT* track_point(session_arena* arena, EC_POINT* point) {
+  if (point == NULL) {
+    return NULL;
+  }
+  arena_points* record = arena->points;
+  if (record == NULL || record->count == ARENA_POINTS_PER_RECORD) {
+    record = arena_alloc(arena, sizeof(arena_points));
+    if (record == NULL) {
+      EC_POINT_free(point);
+      return NULL;
+    }
+    record->next = arena->points;
+    arena->points = record;
+  }
+  record->point[record->count++] = point;
+  arena->point_count++;
+  return point;
+}
+
+// A point kept by arena_reset, else a new one
+static EC_POINT* reuse_point(session_arena* arena) {
+  if (arena->spare_count == 0) {
+    return group_point_new();
+  }
+  EC_POINT* point = arena->spare_points[--arena->spare_count];
+  EC_POINT_set_to_infinity(EC_group_p256(), point);
+  return point;
+}
+
+EC_POINT* arena_point_new(session_arena* arena) {
+  return track_point(arena, reuse_point(arena));
+}
+
+EC_POINT* arena_point_dup(session_arena* arena, const EC_POINT* point) {
+  if (point == NULL) {
+    return NULL;
+  }
+  EC_POINT* copy = arena_point_new(arena);
+  return copy && EC_POINT_copy(copy, point) ? copy : NULL;
+}
+
+// Moves the points handed out to the spare list; false if it cannot grow
+static bool keep_points(session_arena* arena) {
+  size_t need = arena->spare_count + arena->point_count;
+  if (need > arena->spare_capacity) {
+    EC_POINT** spare =
+        OPENSSL_realloc(arena->spare_points, sizeof(EC_POINT*) * need);
+    if (spare == NULL) {
+      return false;
+    }
+    arena->spare_points = spare;
+    arena->spare_capacity = need;
+  }
+  for (arena_points* record = arena->points; record; record = record->next) {
+    for (size_t i = 0; i < record->count; i++) {
+      arena->spare_points[arena->spare_count++] = record->point[i];
+    }
+  }
+  return true;
+}
+
+void arena_reset(session_arena* arena) {
+  // the point records live in the blocks, so they go first
+  if (!keep_points(arena)) {
+    for (arena_points* record = arena->points; record; record = record->next) {
+      for (size_t i = 0; i < record->count; i++) {
+        EC_POINT_free(record->point[i]);
+      }
+    }
+  }
+  arena->points = NULL;
+  arena->point_count = 0;
+
+  // the head stays the head; every other block waits in the spare list
+  arena_block* head = arena->blocks;
+  for (arena_block* block = head; block != NULL;) {
+    arena_block* next = block->next;
+    OPENSSL_cleanse(block->data, block->used);
+    block->used = 0;
+    if (block != head) {
+      block->next = arena->spare_blocks;
+      arena->spare_blocks = block;
+    }
+    block = next;
+  }
+  head->next = NULL;
+  arena->used = 0;
+}
+
+void arena_free(session_arena* arena) {
+  if (arena == NULL) {
+    return;
+  }
+  // the point records live in the blocks, so they go first
+  for (arena_points* record = arena->points; record; record = record->next) {
+    for (size_t i = 0; i < record->count; i++) {
+      EC_POINT_free(record->point[i]);
+    }
+  }
+
+  for (size_t i = 0; i < arena->spare_count; i++) {
+    EC_POINT_free(arena->spare_points[i]);
+  }
+  OPENSSL_free(arena->spare_points);
+
+  arena_block* lists[] = {arena->blocks, arena->spare_blocks};
+  for (size_t l = 0; l < sizeof(lists) / sizeof(lists[0]); l++) {
+    arena_block* block = lists[l];
+    while (block != NULL) {
+      arena_block* next = block->next;
+      OPENSSL_cleanse(block->data, block->used);
+      OPENSSL_free(block);
+      block = next;
+    }
+  }
+  OPENSSL_free(arena);
+}
@@ -0,0 +1,236 @@
+#include "../headers/batch_verify.h"
+
+#include "../boringssl/include/openssl/bn.h"
+#include "../boringssl/include/openssl/ec.h"
+#include "../boringssl/include/openssl/mem.h"
+#include <pthread.h>
+#include <stdint.h>
+
+#include "../headers/context.h"
+#include "../headers/drbg.h"
+#include "../headers/group.h"
+#include "../headers/msm.h"
+#include "../headers/scalar.h"
+#include "../headers/signing.h"
+
+// Items per combined check. Large enough for the MSM to reach its per-point
+// cost floor; a chunk that fails is re-checked item by item, so an invalid
+// signature costs at most one chunk of single verifications.
+#define BATCH_CHUNK 1024
+
+// below this many items a combined check costs more than checking each one
+#define BATCH_MIN_COMBINED 32
+
+// fewer items per thread than this are not worth a thread of their own
+#define BATCH_MIN_SLICE 64
+
+/* One contiguous slice of the batch, verified by one thread */
+typedef struct {
+  const signature_batch_item* items;
+  bool* results;
+  size_t count;
+  bool verified;
+
+  // per-item state of the current chunk
+  scalar* z;
+  scalar* c;
+  bool* hashed;
+  challenge_input* challenges;
+  uint8_t* parsed;
+
+  // MSM operands, sized for one chunk
+  const EC_POINT** points;
+  scalar* weights;
+  frost_ctx* ctx;  // the caller's, or the worker thread's own
+} batch_slice;
+
+/* 128-bit ρ: enough to make a forged batch pass with probability 2^-128, and
+ * the R_i terms then only have nonzero digits in the low half of the MSM */
+static bool random_weight(frost_ctx* ctx, scalar* rho) {
+  uint8_t buf[SCALAR_BYTES] = {0};
+  if (!random_bytes(ctx->rng, buf + SCALAR_BYTES / 2, SCALAR_BYTES / 2)) {
+    return false;
+  }
+  scalar_from_bytes(rho, buf);
+  return true;
+}
+
+static bool same_key(const EC_POINT* a, const EC_POINT* b, frost_ctx* ctx) {
+  return a == b || EC_POINT_cmp(ctx->group, a, b, ctx->bn) == 0;
+}
+
+/* G ^ z = R * Y ^ c for item i of the chunk */
+static bool verify_single(batch_slice* s, const signature_batch_item* item,
+                          size_t i) {
+  scalar minus_c;
+  EC_POINT* R0 = group_point_new();
+  scalar_neg(&minus_c, &s->c[i]);
+  bool verified = R0 &&
+                  group_double_mul(R0, &s->z[i], item->public_key, &minus_c,
+                                   s->ctx) &&
+                  EC_POINT_cmp(s->ctx->group, R0, item->R, s->ctx->bn) == 0;
+  EC_POINT_free(R0);
+  return verified;
+}
+
+/* The randomised combined equation over the parsed items of a chunk */
+static bool verify_combined(batch_slice* s, const signature_batch_item* items,
+                            size_t count) {
+  scalar combined, rho, weighted;
+  size_t terms = 0, key_term = 0;
+  const EC_POINT* prev_key = NULL;
+  bool ok = true;
+
+  scalar_zero(&combined);
+  for (size_t i = 0; ok && i < count; i++) {
+    if (!s->parsed[i]) continue;
+    ok = random_weight(s->ctx, &rho);
+
+    scalar_mul(&weighted, &rho, &s->z[i]);
+    scalar_add(&combined, &combined, &weighted);
+
+    s->points[terms] = items[i].R;
+    s->weights[terms++] = rho;
+
+    scalar_mul(&weighted, &rho, &s->c[i]);
+    if (prev_key != NULL && same_key(prev_key, items[i].public_key, s->ctx)) {
+      scalar_add(&s->weights[key_term], &s->weights[key_term], &weighted);
+    } else {
+      key_term = terms;
+      prev_key = items[i].public_key;
+      s->points[terms] = prev_key;
+      s->weights[terms++] = weighted;
+    }
+  }
+  if (!ok || terms == 0) {
+    return ok;
+  }
+
+  EC_POINT* lhs = group_point_new();
+  EC_POINT* rhs = group_point_new();
+  ok = lhs && rhs && group_base_mul(lhs, &combined, s->ctx) &&
+       msm(rhs, s->points, s->weights, terms, s->ctx) &&
+       EC_POINT_cmp(s->ctx->group, lhs, rhs, s->ctx->bn) == 0;
+  EC_POINT_free(lhs);
+  EC_POINT_free(rhs);
+  return ok;
+}
+
+static bool verify_chunk(batch_slice* s, const signature_batch_item* items,
+                         bool* results, size_t count) {
+  bool all_parsed = true;
+  for (size_t i = 0; i < count; i++) {
+    const signature_batch_item* item = &items[i];
+    s->parsed[i] = (item->m || item->m_size == 0) && item->R &&
+                   item->signature && item->public_key &&
+                   scalar_from_bn(&s->z[i], item->signature);
+    s->challenges[i] = (challenge_input){
+        s->parsed[i] ? item->R : NULL, item->public_key, item->m,
+        item->m_size};
+  }
+  // the challenges of the whole chunk side by side
+  hash_func_batch(s->c, s->hashed, s->challenges, count);
+  for (size_t i = 0; i < count; i++) {
+    s->parsed[i] = s->parsed[i] && s->hashed[i];
+    all_parsed = all_parsed && s->parsed[i];
+  }
+
+  if (count >= BATCH_MIN_COMBINED && verify_combined(s, items, count)) {
+    for (size_t i = 0; i < count; i++) {
+      results[i] = s->parsed[i];
+    }
+    return all_parsed;
+  }
+
+  bool all = true;
+  for (size_t i = 0; i < count; i++) {
+    results[i] = s->parsed[i] && verify_single(s, &items[i], i);
+    all = all && results[i];
+  }
+  return all;
+}
+
+static void* verify_slice(void* arg) {
+  batch_slice* s = arg;
+  size_t n = s->count < BATCH_CHUNK ? s->count : BATCH_CHUNK;
+
+  s->z = OPENSSL_malloc(sizeof(scalar) * n);
+  s->c = OPENSSL_malloc(sizeof(scalar) * n);
+  s->hashed = OPENSSL_malloc(sizeof(bool) * n);
+  s->challenges = OPENSSL_malloc(sizeof(challenge_input) * n);
+  s->parsed = OPENSSL_malloc(n);
+  s->points = OPENSSL_malloc(sizeof(EC_POINT*) * 2 * n);
+  s->weights = OPENSSL_malloc(sizeof(scalar) * 2 * n);
+  if (s->ctx == NULL) {
+    s->ctx = frost_thread_ctx();
+  }
+  s->verified = s->z && s->c && s->hashed && s->challenges && s->parsed &&
+                s->points && s->weights && s->ctx;
+
+  if (s->verified) {
+    for (size_t lo = 0; lo < s->count; lo += n) {
+      size_t len = s->count - lo < n ? s->count - lo : n;
+      s->verified =
+          verify_chunk(s, s->items + lo, s->results + lo, len) && s->verified;
+    }
+  } else {
+    for (size_t i = 0; i < s->count; i++) {
+      s->results[i] = false;
+    }
+  }
+
+  OPENSSL_free(s->z);
+  OPENSSL_free(s->c);
+  OPENSSL_free(s->hashed);
+  OPENSSL_free(s->challenges);
+  OPENSSL_free(s->parsed);
+  OPENSSL_free(s->points);
+  OPENSSL_free(s->weights);
+  return NULL;
+}
+
+bool verify_signature_batch(const signature_batch_item* items, size_t count,
+                            int threads, bool* results, frost_ctx* ctx) {
+  if (count == 0) {
+    return true;
+  }
+
+  size_t workers = threads > 1 ? (size_t)threads : 1;
+  if (workers > BATCH_VERIFY_MAX_THREADS) workers = BATCH_VERIFY_MAX_THREADS;
+  if (workers > (count + BATCH_MIN_SLICE - 1) / BATCH_MIN_SLICE) {
+    workers = (count + BATCH_MIN_SLICE - 1) / BATCH_MIN_SLICE;
+  }
+
+  batch_slice slices[BATCH_VERIFY_MAX_THREADS];
+  pthread_t tids[BATCH_VERIFY_MAX_THREADS];
+  bool started[BATCH_VERIFY_MAX_THREADS];
+
+  size_t begin = 0;
+  for (size_t w = 0; w < workers; w++) {
+    size_t len = count / workers + (w < count % workers ? 1 : 0);
+    slices[w] = (batch_slice){.items = items + begin,
+                              .results = results + begin,
+                              .count = len,
+                              .ctx = w == 0 ? ctx : NULL};
+    begin += len;
+  }
+
+  // slice 0 runs on the calling thread; a worker that cannot start runs here too
+  for (size_t w = 1; w < workers; w++) {
+    started[w] =
+        pthread_create(&tids[w], NULL, verify_slice, &slices[w]) == 0;
+  }
+  verify_slice(&slices[0]);
+
+  bool verified = slices[0].verified;
+  for (size_t w = 1; w < workers; w++) {
+    if (started[w]) {
+      pthread_join(tids[w], NULL);
+    } else {
+      slices[w].ctx = ctx;
+      verify_slice(&slices[w]);
+    }
+    verified = verified && slices[w].verified;
+  }
+  return verified;
+}
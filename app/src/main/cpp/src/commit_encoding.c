@@ -0,0 +1,18 @@
+#include "../headers/commit_encoding.h"
+
+bool commit_points_encode(uint8_t* out, EC_POINT* const* points, size_t count,
+                          frost_ctx* ctx) {
+  for (size_t k = 0; k < count; k++) {
+    if (EC_POINT_point2oct(ctx->group, points[k],
+                           POINT_CONVERSION_UNCOMPRESSED,
+                           out + k * COMMIT_POINT_BYTES, COMMIT_POINT_BYTES,
+                           ctx->bn) != COMMIT_POINT_BYTES) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool commit_point_decode(EC_POINT* out, const uint8_t* in, frost_ctx* ctx) {
+  return EC_POINT_oct2point(ctx->group, out, in, COMMIT_POINT_BYTES, ctx->bn);
+}
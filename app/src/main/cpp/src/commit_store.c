@@ -0,0 +1,82 @@
+#include "../headers/commit_store.h"
+
+#include <string.h>
+
+commit_store* commit_store_new(size_t participants, size_t threshold) {
+  session_arena* arena = arena_new();
+  if (arena == NULL) {
+    return NULL;
+  }
+  size_t stride = threshold * COMMIT_POINT_BYTES;
+  stride = (stride + COMMIT_STORE_ALIGN - 1) &
+           ~(size_t)(COMMIT_STORE_ALIGN - 1);
+
+  // the arena aligns less than a cache line: over-allocate and round up
+  commit_store* store = arena_alloc(arena, sizeof(commit_store));
+  uint8_t* block =
+      arena_alloc(arena, participants * stride + COMMIT_STORE_ALIGN - 1);
+  if (store == NULL || block == NULL ||
+      !presence_init(&store->published, arena, participants)) {
+    arena_free(arena);
+    return NULL;
+  }
+  store->arena = arena;
+  store->rows = participants;
+  store->threshold = threshold;
+  store->stride = stride;
+  store->data = (uint8_t*)(((uintptr_t)block + COMMIT_STORE_ALIGN - 1) &
+                           ~(uintptr_t)(COMMIT_STORE_ALIGN - 1));
+  store->refs = 1;
+  return store;
+}
+
+commit_store* commit_store_retain(commit_store* store) {
+  __atomic_add_fetch(&store->refs, 1, __ATOMIC_RELAXED);
+  return store;
+}
+
+void commit_store_release(commit_store* store) {
+  if (store != NULL &&
+      __atomic_sub_fetch(&store->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    // the store lives in its own arena, with the matrix
+    arena_free(store->arena);
+  }
+}
+
+bool commit_store_publish(commit_store* store, int sender_index,
+                          const uint8_t* commit, size_t commit_len,
+                          frost_ctx* ctx) {
+  size_t threshold = store->threshold;
+  if (sender_index < 0 || (size_t)sender_index >= store->rows ||
+      commit_len != threshold ||
+      presence_test(&store->published, sender_index)) {
+    return false;
+  }
+
+  // every point must decode; only the encoded row is kept
+  EC_POINT* point = EC_POINT_new(ctx->group);
+  bool ok = point != NULL;
+  for (size_t k = 0; ok && k < threshold; k++) {
+    ok = commit_point_decode(point, commit + k * COMMIT_POINT_BYTES, ctx);
+  }
+  EC_POINT_free(point);
+  if (!ok) {
+    return false;
+  }
+  memcpy(store->data + sender_index * store->stride, commit,
+         COMMIT_POINT_BYTES * threshold);
+  return presence_add(&store->published, sender_index);
+}
+
+const uint8_t* commit_store_row(const commit_store* store, int sender_index) {
+  if (sender_index < 0 ||
+      !presence_test(&store->published, sender_index)) {
+    return NULL;
+  }
+  return store->data + sender_index * store->stride;
+}
+
+const uint8_t* commit_store_point(const commit_store* store, size_t row,
+                                  size_t k) {
+  return store->data + row * store->stride + k * COMMIT_POINT_BYTES;
+}
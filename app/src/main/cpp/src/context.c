@@ -0,0 +1,60 @@
+#include "../headers/context.h"
+
+#include "../boringssl/include/openssl/mem.h"
+#include <pthread.h>
+
+#include "../headers/drbg.h"
+#include "../headers/msm.h"
+
+frost_ctx* frost_ctx_new() {
+  frost_ctx* ctx = OPENSSL_zalloc(sizeof(frost_ctx));
+  if (ctx == NULL) {
+    return NULL;
+  }
+  ctx->group = EC_group_p256();
+  ctx->bn = BN_CTX_new();
+  ctx->scratch = msm_scratch_new();
+  ctx->rng = drbg_new();
+  if (!ctx->group || !ctx->bn || !ctx->scratch || !ctx->rng) {
+    frost_ctx_free(ctx);
+    return NULL;
+  }
+  return ctx;
+}
+
+void frost_ctx_free(frost_ctx* ctx) {
+  if (ctx == NULL) {
+    return;
+  }
+  BN_CTX_free(ctx->bn);
+  msm_scratch_free(ctx->scratch);
+  drbg_free(ctx->rng);
+  OPENSSL_free(ctx);
+}
+
+static pthread_key_t ctx_key;
+static pthread_once_t ctx_once = PTHREAD_ONCE_INIT;
+static bool ctx_key_ready;
+
+static void free_thread_ctx(void* ctx) { frost_ctx_free(ctx); }
+
+static void init_ctx_key() {
+  ctx_key_ready = pthread_key_create(&ctx_key, free_thread_ctx) == 0;
+}
+
+frost_ctx* frost_thread_ctx() {
+  pthread_once(&ctx_once, init_ctx_key);
+  if (!ctx_key_ready) {
+    return NULL;
+  }
+
+  frost_ctx* ctx = pthread_getspecific(ctx_key);
+  if (ctx == NULL) {
+    ctx = frost_ctx_new();
+    if (ctx != NULL && pthread_setspecific(ctx_key, ctx) != 0) {
+      frost_ctx_free(ctx);
+      ctx = NULL;
+    }
+  }
+  return ctx;
+}
@@ -0,0 +1,108 @@
+#include "../headers/drbg.h"
+
+#include "../boringssl/include/openssl/ctrdrbg.h"
+#include "../boringssl/include/openssl/mem.h"
+#include "../boringssl/include/openssl/rand.h"
+#include <pthread.h>
+
+// scalars drawn per generate call in random_scalars
+#define DRBG_SCALAR_BATCH 64
+
+#define DRBG_PERSONALIZATION "FROST-P256-SHA256-v1 drbg"
+
+struct scalar_drbg {
+  CTR_DRBG_STATE* drbg;
+  unsigned generation;  // fork_generation when last seeded
+  unsigned calls;       // generate calls since then
+};
+
+static pthread_once_t fork_once = PTHREAD_ONCE_INIT;
+static bool fork_hook_ready;
+static unsigned fork_generation;
+
+static void on_fork_child() {
+  __atomic_add_fetch(&fork_generation, 1, __ATOMIC_RELAXED);
+}
+
+static void init_fork_hook() {
+  fork_hook_ready = pthread_atfork(NULL, NULL, on_fork_child) == 0;
+}
+
+static bool seed(scalar_drbg* t, unsigned generation) {
+  uint8_t entropy[CTR_DRBG_ENTROPY_LEN];
+  bool ok = RAND_bytes(entropy, sizeof(entropy)) == 1;
+  if (ok && t->drbg == NULL) {
+    t->drbg = CTR_DRBG_new(entropy, (const uint8_t*)DRBG_PERSONALIZATION,
+                           sizeof(DRBG_PERSONALIZATION) - 1);
+    ok = t->drbg != NULL;
+  } else if (ok) {
+    ok = CTR_DRBG_reseed(t->drbg, entropy, NULL, 0) == 1;
+  }
+  OPENSSL_cleanse(entropy, sizeof(entropy));
+
+  t->generation = generation;
+  t->calls = 0;
+  return ok;
+}
+
+scalar_drbg* drbg_new() {
+  // without the fork hook a child could repeat its parent's stream
+  pthread_once(&fork_once, init_fork_hook);
+  if (!fork_hook_ready) {
+    return NULL;
+  }
+
+  scalar_drbg* t = OPENSSL_zalloc(sizeof(scalar_drbg));
+  if (t == NULL) {
+    return NULL;
+  }
+  if (!seed(t, __atomic_load_n(&fork_generation, __ATOMIC_RELAXED))) {
+    drbg_free(t);
+    return NULL;
+  }
+  return t;
+}
+
+void drbg_free(scalar_drbg* t) {
+  if (t == NULL) {
+    return;
+  }
+  CTR_DRBG_free(t->drbg);
+  OPENSSL_free(t);
+}
+
+bool random_bytes(scalar_drbg* t, uint8_t* out, size_t len) {
+  while (len > 0) {
+    unsigned generation = __atomic_load_n(&fork_generation, __ATOMIC_RELAXED);
+    if ((t->generation != generation || t->calls >= DRBG_RESEED_INTERVAL) &&
+        !seed(t, generation)) {
+      return false;
+    }
+
+    size_t n = len < CTR_DRBG_MAX_GENERATE_LENGTH ? len
+                                                   : CTR_DRBG_MAX_GENERATE_LENGTH;
+    if (CTR_DRBG_generate(t->drbg, out, n, NULL, 0) != 1) {
+      return false;
+    }
+    t->calls++;
+    out += n;
+    len -= n;
+  }
+  return true;
+}
+
+bool random_scalars(scalar_drbg* rng, scalar* out, size_t count) {
+  uint8_t wide[DRBG_SCALAR_BATCH][2 * SCALAR_BYTES];
+  bool ok = true;
+  while (ok && count > 0) {
+    size_t n = count < DRBG_SCALAR_BATCH ? count : DRBG_SCALAR_BATCH;
+    ok = random_bytes(rng, wide[0], n * sizeof(wide[0]));
+    for (size_t i = 0; ok && i < n; i++) {
+      scalar_from_wide(&out[i], wide[i]);
+    }
+    out += n;
+    count -= n;
+  }
+  OPENSSL_cleanse(wide, sizeof(wide));
+  return ok;
+}
@@ -0,0 +1,66 @@
+#include "../headers/group.h"
+
+#include "../boringssl/include/openssl/bn.h"
+#include "../boringssl/include/openssl/ec.h"
+
+EC_POINT* group_point_new() { return EC_POINT_new(EC_group_p256()); }
+
+EC_POINT* group_point_dup(const EC_POINT* p) {
+  return EC_POINT_dup(p, EC_group_p256());
+}
+
+bool group_base_mul(EC_POINT* out, const scalar* k, frost_ctx* ctx) {
+  BN_CTX_start(ctx->bn);
+  BIGNUM* b_k = BN_CTX_get(ctx->bn);
+  bool ok = b_k && scalar_to_bn(k, b_k) &&
+            EC_POINT_mul(ctx->group, out, b_k, NULL, NULL, ctx->bn);
+  if (b_k) {
+    BN_clear(b_k);
+  }
+  BN_CTX_end(ctx->bn);
+  return ok;
+}
+
+bool group_base_mul_batch(EC_POINT** out, const scalar* k, size_t count,
+                          frost_ctx* ctx) {
+  BN_CTX_start(ctx->bn);
+  BIGNUM* b_k = BN_CTX_get(ctx->bn);
+  bool ok = b_k != NULL;
+  for (size_t i = 0; ok && i < count; i++) {
+    ok = scalar_to_bn(&k[i], b_k) &&
+         EC_POINT_mul(ctx->group, out[i], b_k, NULL, NULL, ctx->bn);
+  }
+  if (b_k) {
+    BN_clear(b_k);
+  }
+  BN_CTX_end(ctx->bn);
+  return ok;
+}
+
+bool group_mul(EC_POINT* out, const EC_POINT* p, const scalar* k,
+               frost_ctx* ctx) {
+  BN_CTX_start(ctx->bn);
+  BIGNUM* b_k = BN_CTX_get(ctx->bn);
+  bool ok = b_k && scalar_to_bn(k, b_k) &&
+            EC_POINT_mul(ctx->group, out, NULL, p, b_k, ctx->bn);
+  if (b_k) {
+    BN_clear(b_k);
+  }
+  BN_CTX_end(ctx->bn);
+  return ok;
+}
+
+bool group_double_mul(EC_POINT* out, const scalar* a, const EC_POINT* p,
+                      const scalar* b, frost_ctx* ctx) {
+  BN_CTX_start(ctx->bn);
+  BIGNUM* b_a = BN_CTX_get(ctx->bn);
+  BIGNUM* b_b = BN_CTX_get(ctx->bn);
+  bool ok = b_b && scalar_to_bn(a, b_a) && scalar_to_bn(b, b_b) &&
+            EC_POINT_mul(ctx->group, out, b_a, p, b_b, ctx->bn);
+  if (b_b) {
+    BN_clear(b_a);
+    BN_clear(b_b);
+  }
+  BN_CTX_end(ctx->bn);
+  return ok;
+}
@@ -0,0 +1,361 @@
+#include "../headers/lagrange.h"
+#include "../headers/setup.h"
+
+#include "../boringssl/include/openssl/crypto.h"
+#include "../boringssl/include/openssl/mem.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void scalar_set_int(scalar* r, int64_t v) {
+  if (v < 0) {
+    scalar_set_word(r, (uint64_t)(-v));
+    scalar_neg(r, r);
+  } else {
+    scalar_set_word(r, (uint64_t)v);
+  }
+}
+
+/* Montgomery's trick: replaces every v[i] by its inverse with one inversion
+ * and 3(count - 1) multiplications. None of the v[i] may be zero. */
+static void batch_invert(scalar* v, size_t count, scalar* prefix) {
+  prefix[0] = v[0];
+  for (size_t i = 1; i < count; i++) {
+    scalar_mul(&prefix[i], &prefix[i - 1], &v[i]);
+  }
+
+  scalar inv, tmp;
+  scalar_inv(&inv, &prefix[count - 1]);
+  for (size_t i = count - 1; i > 0; i--) {
+    scalar_mul(&tmp, &inv, &prefix[i - 1]);
+    scalar_mul(&inv, &inv, &v[i]);
+    v[i] = tmp;
+  }
+  v[0] = inv;
+}
+
+/* numerators[i] = ∏_{j≠i} x_j from prefix and suffix products */
+static void lagrange_numerators(const int* indices, size_t count,
+                                scalar* numerators) {
+  scalar x, suffix;
+  scalar_one(&numerators[0]);
+  for (size_t i = 1; i < count; i++) {
+    scalar_set_word(&x, participant_identifier(indices[i - 1]));
+    scalar_mul(&numerators[i], &numerators[i - 1], &x);
+  }
+  scalar_one(&suffix);
+  for (size_t i = count; i-- > 0;) {
+    scalar_mul(&numerators[i], &numerators[i], &suffix);
+    scalar_set_word(&x, participant_identifier(indices[i]));
+    scalar_mul(&suffix, &suffix, &x);
+  }
+}
+
+/* Denominators ∏_{j≠i} (x_j - x_i) pairwise: O(t^2) multiplications. */
+static bool lagrange_sparse(const int* indices, size_t count, scalar* lambdas,
+                            scalar* den, scalar* scratch) {
+  for (size_t i = 0; i < count; i++) {
+    scalar diff;
+    scalar_one(&den[i]);
+    for (size_t j = 0; j < count; j++) {
+      if (j == i) continue;
+      scalar_set_int(&diff, (int64_t)indices[j] - indices[i]);
+      scalar_mul(&den[i], &den[i], &diff);
+    }
+    if (scalar_is_zero(&den[i])) {
+      return false;  // repeated index
+    }
+  }
+
+  batch_invert(den, count, scratch);
+  for (size_t i = 0; i < count; i++) {
+    scalar_mul(&lambdas[i], &lambdas[i], &den[i]);
+  }
+  return true;
+}
+
+/*
+ * Signer sets that cover most of [lo, hi] (large t-of-n groups): over the full
+ * range the denominator is (-1)^a a! b! with a = x_i - lo, b = hi - x_i, so
+ * only the N - t absent indices need a per-signer product. The inverse
+ * factorials come from one inversion of (N - 1)!.
+ */
+static bool lagrange_dense(const int* indices, size_t count, int lo, int hi,
+                           scalar* lambdas) {
+  size_t span = (size_t)(hi - lo) + 1;
+  uint8_t* present = OPENSSL_zalloc(span);
+  scalar* inv_fact = OPENSSL_malloc(sizeof(scalar) * span);
+  int* missing = OPENSSL_malloc(sizeof(int) * (span - count + 1));
+  bool ok = present && inv_fact && missing;
+
+  for (size_t i = 0; ok && i < count; i++) {
+    size_t slot = (size_t)(indices[i] - lo);
+    ok = !present[slot];  // repeated index
+    present[slot] = 1;
+  }
+
+  if (ok) {
+    size_t missing_len = 0;
+    for (size_t k = 0; k < span; k++) {
+      if (!present[k]) {
+        missing[missing_len++] = lo + (int)k;
+      }
+    }
+
+    // inv_fact[k] = 1 / k!
+    scalar k_word;
+    scalar_one(&inv_fact[0]);
+    for (size_t k = 1; k < span; k++) {
+      scalar_set_word(&k_word, k);
+      scalar_mul(&inv_fact[k], &inv_fact[k - 1], &k_word);
+    }
+    scalar_inv(&inv_fact[span - 1], &inv_fact[span - 1]);
+    for (size_t k = span - 1; k > 0; k--) {
+      scalar_set_word(&k_word, k);
+      scalar_mul(&inv_fact[k - 1], &inv_fact[k], &k_word);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      size_t a = (size_t)(indices[i] - lo);
+      size_t b = (size_t)(hi - indices[i]);
+      scalar factor, diff;
+
+      scalar_mul(&factor, &inv_fact[a], &inv_fact[b]);
+      if (a & 1) {
+        scalar_neg(&factor, &factor);
+      }
+      for (size_t k = 0; k < missing_len; k++) {
+        scalar_set_int(&diff, (int64_t)missing[k] - indices[i]);
+        scalar_mul(&factor, &factor, &diff);
+      }
+      scalar_mul(&lambdas[i], &lambdas[i], &factor);
+    }
+  }
+
+  OPENSSL_free(present);
+  OPENSSL_free(inv_fact);
+  OPENSSL_free(missing);
+  return ok;
+}
+
+bool lagrange_coefficients(const int* indices, size_t count, scalar* lambdas) {
+  if (count == 0) {
+    return false;
+  }
+
+  int lo = indices[0], hi = indices[0];
+  for (size_t i = 0; i < count; i++) {
+    if (indices[i] < 0) {
+      return false;
+    }
+    if (indices[i] < lo) lo = indices[i];
+    if (indices[i] > hi) hi = indices[i];
+  }
+
+  lagrange_numerators(indices, count, lambdas);
+  if (count == 1) {
+    return true;
+  }
+
+  // pick the cheaper denominator strategy by multiplication count
+  double t = (double)count, span = (double)hi - lo + 1;
+  if (span >= t && 3 * span + t * (span - t) < t * t) {
+    return lagrange_dense(indices, count, lo, hi, lambdas);
+  }
+
+  scalar* den = OPENSSL_malloc(sizeof(scalar) * count * 2);
+  if (den == NULL) {
+    return false;
+  }
+  bool ok = lagrange_sparse(indices, count, lambdas, den, den + count);
+  OPENSSL_free(den);
+  return ok;
+}
+
+/* Lagrange cache */
+
+typedef struct {
+  uint64_t hash;
+  size_t count;
+  int* key;        // sorted signer indices
+  scalar* lambda;  // λ in key order
+  uint64_t last_used;
+} lagrange_cache_entry;
+
+static lagrange_cache_entry cache[LAGRANGE_CACHE_CAPACITY];
+static uint64_t cache_clock;
+static uint64_t cache_hits;
+static uint64_t cache_misses;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int compare_index(const void* a, const void* b) {
+  int x = *(const int*)a, y = *(const int*)b;
+  return (x > y) - (x < y);
+}
+
+// Sets up to this size are looked up with the key on the stack
+#define LAGRANGE_STACK_KEY 64
+
+/* Sorted copy of the set plus its FNV-1a hash, in stack_key if it fits;
+ * NULL for invalid sets. */
+static int* canonical_key(const int* indices, size_t count, int* stack_key,
+                          uint64_t* hash) {
+  if (count == 0) {
+    return NULL;
+  }
+  int* key = count <= LAGRANGE_STACK_KEY ? stack_key
+                                         : malloc(sizeof(int) * count);
+  if (key == NULL) {
+    return NULL;
+  }
+  memcpy(key, indices, sizeof(int) * count);
+  qsort(key, count, sizeof(int), compare_index);
+
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < count; i++) {
+    if (key[i] < 0 || (i > 0 && key[i] == key[i - 1])) {
+      if (key != stack_key) free(key);
+      return NULL;
+    }
+    for (int b = 0; b < 4; b++) {
+      h ^= ((uint32_t)key[i] >> (8 * b)) & 0xff;
+      h *= 0x100000001b3ULL;
+    }
+  }
+  *hash = h;
+  return key;
+}
+
+// caller holds cache_lock
+static lagrange_cache_entry* cache_find(const int* key, size_t count,
+                                        uint64_t hash) {
+  for (size_t i = 0; i < LAGRANGE_CACHE_CAPACITY; i++) {
+    lagrange_cache_entry* e = &cache[i];
+    if (e->key != NULL && e->hash == hash && e->count == count &&
+        memcmp(e->key, key, sizeof(int) * count) == 0) {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+// caller holds cache_lock; takes ownership of key and lambda
+static void cache_insert(int* key, scalar* lambda, size_t count,
+                         uint64_t hash) {
+  lagrange_cache_entry* victim = &cache[0];
+  for (size_t i = 0; i < LAGRANGE_CACHE_CAPACITY; i++) {
+    if (cache[i].key == NULL) {
+      victim = &cache[i];
+      break;
+    }
+    if (cache[i].last_used < victim->last_used) {
+      victim = &cache[i];
+    }
+  }
+  free(victim->key);
+  OPENSSL_free(victim->lambda);
+
+  victim->hash = hash;
+  victim->count = count;
+  victim->key = key;
+  victim->lambda = lambda;
+  victim->last_used = ++cache_clock;
+}
+
+static void copy_wanted(const int* key, const scalar* lambda, size_t count,
+                        const int* wanted, size_t wanted_count, scalar* out) {
+  for (size_t i = 0; i < wanted_count; i++) {
+    const int* pos = bsearch(&wanted[i], key, count, sizeof(int), compare_index);
+    out[i] = lambda[pos - key];
+  }
+}
+
+/* Writes λ for each of the wanted indices, which must belong to the set. */
+static bool cache_fetch(const int* indices, size_t count, const int* wanted,
+                        size_t wanted_count, scalar* out) {
+  uint64_t hash;
+  int stack_key[LAGRANGE_STACK_KEY];
+  int* key = canonical_key(indices, count, stack_key, &hash);
+  if (key == NULL) {
+    return false;
+  }
+  for (size_t i = 0; i < wanted_count; i++) {
+    if (!bsearch(&wanted[i], key, count, sizeof(int), compare_index)) {
+      if (key != stack_key) free(key);
+      return false;
+    }
+  }
+
+  pthread_mutex_lock(&cache_lock);
+  lagrange_cache_entry* e = cache_find(key, count, hash);
+  if (e != NULL) {
+    cache_hits++;
+    e->last_used = ++cache_clock;
+    copy_wanted(e->key, e->lambda, count, wanted, wanted_count, out);
+    pthread_mutex_unlock(&cache_lock);
+    if (key != stack_key) free(key);
+    return true;
+  }
+  cache_misses++;
+  pthread_mutex_unlock(&cache_lock);
+
+  // a hit allocates nothing; a miss gives the cache a key of its own
+  if (key == stack_key) {
+    key = malloc(sizeof(int) * count);
+    if (key == NULL) {
+      return false;
+    }
+    memcpy(key, stack_key, sizeof(int) * count);
+  }
+
+  // compute outside the lock; another thread may race us to the same set
+  scalar* lambda = OPENSSL_malloc(sizeof(scalar) * count);
+  if (lambda == NULL || !lagrange_coefficients(key, count, lambda)) {
+    OPENSSL_free(lambda);
+    free(key);
+    return false;
+  }
+  copy_wanted(key, lambda, count, wanted, wanted_count, out);
+
+  pthread_mutex_lock(&cache_lock);
+  if (cache_find(key, count, hash) == NULL) {
+    cache_insert(key, lambda, count, hash);
+    key = NULL;
+    lambda = NULL;
+  }
+  pthread_mutex_unlock(&cache_lock);
+
+  OPENSSL_free(lambda);
+  free(key);
+  return true;
+}
+
+bool lagrange_cache_get(const int* indices, size_t count, scalar* lambdas) {
+  return cache_fetch(indices, count, indices, count, lambdas);
+}
+
+bool lagrange_cache_coefficient(const int* indices, size_t count, int index,
+                                scalar* lambda) {
+  return cache_fetch(indices, count, &index, 1, lambda);
+}
+
+void lagrange_cache_stats(uint64_t* hits, uint64_t* misses) {
+  pthread_mutex_lock(&cache_lock);
+  *hits = cache_hits;
+  *misses = cache_misses;
+  pthread_mutex_unlock(&cache_lock);
+}
+
+void lagrange_cache_clear() {
+  pthread_mutex_lock(&cache_lock);
+  for (size_t i = 0; i < LAGRANGE_CACHE_CAPACITY; i++) {
+    free(cache[i].key);
+    OPENSSL_free(cache[i].lambda);
+    memset(&cache[i], 0, sizeof(cache[i]));
+  }
+  cache_hits = 0;
+  cache_misses = 0;
+  pthread_mutex_unlock(&cache_lock);
+}
@@ -6,17 +6,27 @@
 #include <android/log.h>
 #include "../headers/setup.h"
 #include "../headers/signing.h"
+#include "../headers/alloc_stats.h"
+#include "../headers/arena.h"
+#include "../headers/context.h"
 #include "../headers/globals.h"
+#include "../headers/message.h"
+#include "../headers/nonce.h"
+#include "../headers/prehash.h"
+#include "../headers/signer_set.h"
 
 #define LOG_TAG "NativeFrost"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 
+// nonce pairs each signer preprocesses per run
+#define NONCE_BATCH 4
+
 
 
 // Function to initialize participants
 // Your initialization function
-participant* initialize_participants(int threshold, int participants) {
+participant* initialize_participants(int threshold, int participants, session_arena* arena) {
     LOGI("Initializing participants: threshold = %d, participants = %d", threshold, participants);
 
     participant* p = (participant*)malloc(participants * sizeof(participant));
@@ -26,12 +36,18 @@ participant* initialize_participants(int threshold, int participants) {
     }
 
     for (int i = 0; i < participants; i++) {
+        p[i].arena = arena;
         p[i].index = i;
         p[i].threshold = threshold;
         p[i].participants = participants;
+        p[i].list = NULL;
         p[i].pub_commit = NULL;
-        p[i].rcvd_commit_head = NULL;
-        p[i].rcvd_sec_share_head = NULL;
+        p[i].commits = NULL;
+        p[i].rcvd_sec_shares = NULL;
+        p[i].sec_shares_in = (presence_map){0};
+        p[i].nonces = NULL;
+        p[i].rcvd_tuple = NULL;
+        p[i].session = NULL;
         LOGI("Participant %d initialized: threshold = %d, participants = %d", i, threshold, participants);
     }
 
@@ -44,34 +60,34 @@ participant* initialize_participants(int threshold, int participants) {
 
 
 // Function to initialize public commitments
-pub_commit_packet** initialize_pub_commits(participant* p, int participants) {
+pub_commit_packet** initialize_pub_commits(participant* p, int participants, frost_ctx* ctx) {
     LOGI("Initializing public commitments for %d participants", participants);
-    pub_commit_packet** pub_commits = (pub_commit_packet**)malloc(participants * sizeof(pub_commit_packet*));
+    pub_commit_packet** pub_commits = arena_alloc(p->arena, participants * sizeof(pub_commit_packet*));
     if (pub_commits == NULL) {
         LOGE("Memory allocation for public commitments failed");
         return NULL; // Memory allocation failed
     }
 
     for (int i = 0; i < participants; i++) {
-        pub_commits[i] = init_pub_commit(&p[i]);
+        pub_commits[i] = init_pub_commit(&p[i], ctx);
         LOGI("Public commitment initialized for participant %d", i);
     }
 
     return pub_commits;
 }
 
-// Function to initialize the threshold set
-participant* initialize_threshold_set(int threshold, participant* p, int* indices) {
+// The signers by index; the participants themselves are not copied
+signer_set* initialize_threshold_set(int threshold, participant* p, int* indices) {
     LOGI("Initializing threshold set: threshold = %d", threshold);
-    participant* threshold_set = (participant*)malloc(threshold * sizeof(participant));
-    if (threshold_set == NULL) {
-        LOGE("Memory allocation for threshold set failed");
-        return NULL; // Memory allocation failed
+    signer_set* threshold_set = arena_alloc(p->arena, sizeof(signer_set));
+    if (threshold_set == NULL ||
+        !signer_set_init(threshold_set, p->arena, indices, threshold, p->participants)) {
+        LOGE("Invalid threshold set: indices must be distinct participants");
+        return NULL;
     }
 
-    for (int i = 0; i < threshold; i++) {
-        threshold_set[i] = p[indices[i]];
-        LOGI("Threshold set participant %d: index = %d", i, indices[i]);
+    for (size_t i = 0; i < threshold_set->size; i++) {
+        LOGI("Threshold set participant %zu: index = %d", i, threshold_set->indices[i]);
     }
 
     return threshold_set;
@@ -110,102 +126,270 @@ void store_signature_and_hash(signature_packet sig) {
         OPENSSL_free(global_signature);  // Clean up previously allocated memory
         return;  // Handle memory allocation failure if needed
     }
+
+    OPENSSL_free(signature_hex);
+    OPENSSL_free(hash_hex);
+    BN_free(sig.signature);
+    BN_free(sig.hash);
+    EC_POINT_free(sig.R);
 }
 
-// Function to perform signing process
-void perform_signing(int threshold, int participants, const char* message, int* indices) {
-    LOGI("Starting signing process: threshold = %d, participants = %d", threshold, participants);
+// Unused nonces of a signing run; the commitments go with the arena
+static void free_signing_state(participant* p, const signer_set* threshold_set) {
+    for (size_t i = 0; i < threshold_set->size; i++) {
+        participant* signer = &p[threshold_set->indices[i]];
+        nonce_store_free(signer->nonces);
+        signer->nonces = NULL;
+    }
+}
 
-    participant* p = initialize_participants(threshold, participants);
-    if (p == NULL) return;
+// Ends the session: the participants keep their keys and drop every pointer
+// into the arena, which is then wiped and released in one pass
+static void end_session(session_arena* arena, participant* p, int participants) {
+    for (int i = 0; i < participants; i++) {
+        p[i].arena = NULL;
+        p[i].list = NULL;
+        p[i].pub_commit = NULL;
+        commit_store_release(p[i].commits);
+        p[i].commits = NULL;
+        p[i].rcvd_sec_shares = NULL;
+        p[i].sec_shares_in = (presence_map){0};
+        p[i].rcvd_tuple = NULL;
+        arena_free(p[i].session);
+        p[i].session = NULL;
+    }
+    LOGI("Session used %zu bytes in %zu arena bytes and %zu points", arena->used, arena->reserved, arena->point_count);
+    arena_free(arena);
+}
 
-    pub_commit_packet** pub_commits = initialize_pub_commits(p, participants);
-    if (pub_commits == NULL) {
-        free(p);
+// Heap use per phase since the last alloc_stats_reset, if the library counts it
+static void log_alloc_stats() {
+    if (!alloc_stats_enabled()) {
         return;
     }
+    for (int i = 0; i < ALLOC_PHASE_COUNT; i++) {
+        alloc_counters c;
+        alloc_stats_get((alloc_phase)i, &c);
+        LOGI("Heap in %s: %llu allocations, %llu frees, %llu bytes, peak %llu bytes live",
+             alloc_phase_name((alloc_phase)i), (unsigned long long)c.allocs,
+             (unsigned long long)c.frees, (unsigned long long)c.bytes,
+             (unsigned long long)c.peak);
+    }
+}
 
-    // Simulate broadcasting the public commitments to all other participants
-    LOGI("Broadcasting public commitments to all participants");
-    for (int i = 0; i < participants; i++) {
-        for (int j = 0; j < participants; j++) {
-            if (i != j) {
-                LOGI("Participant %d accepts public commitment from participant %d", i, j);
-                accept_pub_commit(&p[i], pub_commits[j]);
-            }
-        }
+// Pedersen DKG among all participants, ending with everyone's keys
+static bool dkg_rounds(participant* p, int threshold, int participants, session_arena* arena, frost_ctx* ctx) {
+    pub_commit_packet** pub_commits = initialize_pub_commits(p, participants, ctx);
+    if (pub_commits == NULL) {
+        return false;
+    }
+
+    // Broadcast: every commitment is validated and copied once, into a
+    // store all the local participants read
+    LOGI("Publishing public commitments to all participants");
+    commit_store* commits = commit_store_new(participants, threshold);
+    bool published = commits != NULL;
+    for (int j = 0; published && j < participants; j++) {
+        published = publish_pub_commit(commits, pub_commits[j], ctx);
+    }
+    for (int i = 0; published && i < participants; i++) {
+        published = accept_commit_store(&p[i], commits);
+    }
+    commit_store_release(commits);
+    if (!published) {
+        LOGE("Public commitments could not be published");
+        return false;
     }
 
     // Initialize and exchange secret shares
     LOGI("Exchanging secret shares between participants");
+    int* receivers = arena_alloc(arena, participants * sizeof(int));
+    if (receivers == NULL) {
+        LOGE("Memory allocation for receiver indices failed");
+        return false;
+    }
+    for (int j = 0; j < participants; j++) {
+        receivers[j] = p[j].index;
+    }
+
     for (int i = 0; i < participants; i++) {
-        BIGNUM* self_share = init_sec_share(&p[i], p[i].index);
-        LOGI("Participant %d generated self-secret share", i);
-        accept_sec_share(&p[i], p[i].index, self_share);
+        scalar* sec_shares = init_sec_shares(&p[i], receivers, participants);
+        if (sec_shares == NULL) {
+            LOGE("Participant %d failed to generate secret shares", i);
+            return false;
+        }
+        LOGI("Participant %d generated secret shares", i);
 
+        // every receiver keeps its share; verification happens in one batch
         for (int j = 0; j < participants; j++) {
-            if (i != j) {
-                BIGNUM* sec_share = init_sec_share(&p[i], p[j].index);
-                LOGI("Participant %d generated secret share for participant %d", i, j);
-                accept_sec_share(&p[j], p[i].index, sec_share);
+            LOGI("Participant %d stores secret share from participant %d", j, i);
+            store_sec_share(&p[j], p[i].index, &sec_shares[j]);
+        }
+        free_sec_shares(sec_shares, participants);
+    }
+
+    // Verify all received shares, naming any cheating dealer
+    LOGI("Verifying received secret shares");
+    for (int i = 0; i < participants; i++) {
+        size_t blamed_count = 0;
+        if (!verify_sec_shares(&p[i], receivers, &blamed_count, ctx)) {
+            for (size_t k = 0; k < blamed_count; k++) {
+                LOGE("Participant %d received an invalid share from participant %d", i, receivers[k]);
             }
+            LOGE("Verification of secret shares failed for participant %d", i);
+            return false;
         }
     }
 
     // Generate keys for all participants
     LOGI("Generating keys for all participants");
     for (int i = 0; i < participants; i++) {
-        gen_keys(&p[i]);
+        gen_keys(&p[i], ctx);
     }
+    return true;
+}
 
-    // Create threshold set
-    participant* threshold_set = initialize_threshold_set(threshold, p, indices);
-    if (threshold_set == NULL) {
-        free(p);
-        free(pub_commits);
+static bool run_dkg(participant* p, int threshold, int participants, session_arena* arena, frost_ctx* ctx) {
+    alloc_phase previous = alloc_phase_enter(ALLOC_PHASE_DKG);
+    bool ok = dkg_rounds(p, threshold, participants, arena, ctx);
+    alloc_phase_enter(previous);
+    return ok;
+}
+
+// Preprocessing: every signer publishes count nonce commitments ahead of
+// time; the aggregator pools them and each session takes one
+static bool preprocess_nonces(aggregator* agg, participant* p, const signer_set* signers, size_t count, frost_ctx* ctx) {
+    alloc_phase previous = alloc_phase_enter(ALLOC_PHASE_PREPROCESS);
+    bool ok = true;
+    for (size_t i = 0; ok && i < signers->size; i++) {
+        pub_share_packet* batch = init_pub_shares(&p[signers->indices[i]], count, ctx);
+        if (batch == NULL) {
+            LOGE("Nonce preprocessing failed for threshold participant %zu", i);
+            ok = false;
+            break;
+        }
+        for (size_t j = 0; j < count; j++) {
+            accept_pub_share(agg, &batch[j]);
+        }
+        LOGI("Published %zu nonce commitments for threshold participant %zu", count, i);
+    }
+    alloc_phase_enter(previous);
+    return ok;
+}
+
+// One signing session, from the tuple to the signature written into sig.
+// Nothing is logged on the way unless it fails, so that it can run without
+// allocating; blamed has room for one entry per signer.
+static bool sign_rounds(aggregator* agg, participant* p, const signer_set* signers,
+                        const message_source* message, signing_mode mode, int* blamed,
+                        signature_packet* sig, frost_ctx* ctx) {
+    // The message is read into the binding factors and the challenge; no
+    // participant holds a copy
+    tuple_packet* agg_tuple = init_tuple_packet_stream(agg, message, mode, signers->indices, (int)signers->size, ctx);
+    if (agg_tuple == NULL) {
+        LOGE("Signing session could not be set up; unseekable messages need the prehashed mode");
+        return false;
+    }
+    for (size_t i = 0; i < signers->size; i++) {
+        accept_tuple(&p[signers->indices[i]], agg_tuple);
+    }
+
+    // Generate signature shares
+    for (size_t i = 0; i < signers->size; i++) {
+        participant* signer = &p[signers->indices[i]];
+        scalar sig_share;
+        if (!init_sig_share(signer, message, mode, &sig_share, ctx)) {
+            LOGE("Participant %d refused to sign", signer->index);
+            continue;  // the missing response fails the verification below
+        }
+        store_sig_share(agg, &sig_share, signer->index);
+        scalar_cleanse(&sig_share);
+    }
+
+    // Verify all responses together, naming any invalid signer
+    size_t blamed_count = 0;
+    if (!verify_sig_shares(agg, blamed, &blamed_count, ctx)) {
+        for (size_t k = 0; k < blamed_count; k++) {
+            LOGE("Invalid signature share from participant %d", blamed[k]);
+        }
+        LOGE("Verification of signature shares failed");
+        return false;
+    }
+
+    // Finalize the signature
+    return signature_into(agg, sig);
+}
+
+static bool sign_session(aggregator* agg, participant* p, const signer_set* signers,
+                         const message_source* message, signing_mode mode, int* blamed,
+                         signature_packet* sig, frost_ctx* ctx) {
+    alloc_phase previous = alloc_phase_enter(ALLOC_PHASE_SIGN);
+    bool ok = sign_rounds(agg, p, signers, message, mode, blamed, sig, ctx);
+    alloc_phase_enter(previous);
+    return ok;
+}
+
+static void free_signature_packet(signature_packet* sig) {
+    BN_free(sig->signature);
+    BN_free(sig->hash);
+    EC_POINT_free(sig->R);
+    *sig = (signature_packet){0};
+}
+
+// Function to perform signing process; mode tells how message gets hashed
+void perform_signing(int threshold, int participants, const message_source* message, signing_mode mode, int* indices) {
+    LOGI("Starting signing process: threshold = %d, participants = %d", threshold, participants);
+    alloc_stats_reset();
+
+    // group, BN_CTX, MSM scratch and RNG of this thread, shared by every step
+    frost_ctx* ctx = frost_thread_ctx();
+    if (ctx == NULL) {
+        LOGE("Operation context could not be allocated");
         return;
     }
 
-    // Initialize public share commitments for chosen participants
-    aggregator agg = { .threshold = threshold, .rcvd_pub_share_head = NULL };
-    pub_share_packet** pub_shares = (pub_share_packet**)malloc(threshold * sizeof(pub_share_packet*));
-    if (pub_shares == NULL) {
-        LOGE("Memory allocation for public shares failed");
-        free(p);
-        free(pub_commits);
-        free(threshold_set);
+    session_arena* arena = arena_new();
+    if (arena == NULL) {
+        LOGE("Session arena could not be allocated");
         return;
     }
 
-    for (int i = 0; i < threshold; i++) {
-        pub_shares[i] = init_pub_share(&threshold_set[i]);
-        accept_pub_share(&agg, pub_shares[i]);
-        LOGI("Public share initialized for threshold participant %d", i);
+    participant* p = initialize_participants(threshold, participants, arena);
+    if (p == NULL) {
+        arena_free(arena);
+        return;
     }
 
-    // Generate and accept tuple packets
-    int m_len = 0;
-    while (message[m_len] != '\0') {
-        m_len++;
+    if (!run_dkg(p, threshold, participants, arena, ctx)) {
+        end_session(arena, p, participants);
+        free(p);
+        return;
     }
-    LOGI("Message length: %d", m_len);
 
-    tuple_packet* agg_tuple = init_tuple_packet(&agg, message, m_len, threshold_set, threshold);
-    for (int i = 0; i < threshold; i++) {
-        accept_tuple(&threshold_set[i], agg_tuple);
-        LOGI("Participant %d accepted tuple packet", i);
+    // Create threshold set
+    signer_set* threshold_set = initialize_threshold_set(threshold, p, indices);
+    if (threshold_set == NULL) {
+        end_session(arena, p, participants);
+        free(p);
+        return;
     }
 
-    // Generate signature shares
-    LOGI("Generating signature shares");
-    for (int i = 0; i < threshold; i++) {
-        BIGNUM* sig_share = init_sig_share(&threshold_set[i]);
-        accept_sig_share(&agg, sig_share, threshold_set[i].index);
-        LOGI("Signature share generated for participant %d", i);
+    aggregator agg = { .arena = arena, .threshold = threshold, .participants = participants };
+    if (!preprocess_nonces(&agg, p, threshold_set, NONCE_BATCH, ctx)) {
+        free_signing_state(p, threshold_set);
+        end_session(arena, p, participants);
+        return;
     }
 
-    // Finalize the signature
-    signature_packet sig = signature(&agg);
+    LOGI("Generating signature shares");
+    int* blamed = arena_alloc(arena, sizeof(int) * threshold);
+    signature_packet sig = {0};
+    if (blamed == NULL || !sign_session(&agg, p, threshold_set, message, mode, blamed, &sig, ctx)) {
+        free_signature_packet(&sig);
+        free_signing_state(p, threshold_set);
+        end_session(arena, p, participants);
+        return;
+    }
     LOGI("Final signature generated");
 
 
@@ -213,9 +397,9 @@ void perform_signing(int threshold, int participants, const char* message, int*
 
 
     // Clean up dynamically allocated memory
-    free(pub_commits);
-    free(pub_shares);
-    free(threshold_set);
+    free_signing_state(p, threshold_set);
+    log_alloc_stats();
+    end_session(arena, p, participants);
 }
 
 void cleanup_participants() {
@@ -229,7 +413,39 @@ void cleanup_participants() {
 
 // Entry point for JNI
 void execute_signing(int threshold, int participants, const char* message, int* indices) {
-    perform_signing(threshold, participants, message, indices);
+    message_source m = message_from_buffer((const uint8_t*)message, strlen(message));
+    perform_signing(threshold, participants, &m, SIGNING_RAW, indices);
+}
+
+// Large artifacts are mapped if they are regular files and read through a
+// fixed buffer otherwise (pipes, sockets)
+static message_source open_message(int fd) {
+    message_source m;
+    if (!message_map_fd(fd, &m)) {
+        m = message_from_fd(fd);
+    }
+    return m;
+}
+
+void execute_signing_fd(int threshold, int participants, int fd, int* indices) {
+    message_source m = open_message(fd);
+    perform_signing(threshold, participants, &m, SIGNING_RAW, indices);
+    message_release(&m);
+}
+
+// Same, signing the versioned Merkle prehash computed on `threads` cores
+void execute_signing_fd_prehashed(int threshold, int participants, int fd, int threads, int* indices) {
+    uint8_t prehash[PREHASH_BYTES];
+    message_source m = open_message(fd);
+    bool ok = prehash_message(&m, threads, prehash);
+    message_release(&m);
+    if (!ok) {
+        LOGE("Reading the message for prehashing failed");
+        return;
+    }
+
+    message_source signed_part = message_from_buffer(prehash, sizeof(prehash));
+    perform_signing(threshold, participants, &signed_part, SIGNING_PREHASHED, indices);
 }
 
 bool verify_signing(const char* message, int index) {
@@ -244,14 +460,81 @@ bool verify_signing(const char* message, int index) {
         return false;
     }
 
+    frost_ctx* ctx = frost_thread_ctx();
+    if (ctx == NULL) {
+        LOGE("Operation context could not be allocated");
+        return false;
+    }
+
     // Retrieve the participant
     participant* temp_p = &global_participants[index];
 
     // Verify the signature
-    if (!verify_signature(global_signature, global_hash, message, temp_p->public_key)) {
+    alloc_phase previous = alloc_phase_enter(ALLOC_PHASE_VERIFY);
+    bool verified = verify_signature(global_signature, global_hash, message, temp_p->public_key, ctx);
+    alloc_phase_enter(previous);
+    if (!verified) {
         LOGE("Signature verification failed for participant %d", index);
         return false;
     }
     return true;
 }
 
+bool verify_signing_fd(int fd, int index) {
+    if (global_participants == NULL) {
+        LOGE("Participants not initialized");
+        return false;
+    }
+
+    if (index < 0 || index >= global_participants_count) {
+        LOGE("Invalid participant index: %d", index);
+        return false;
+    }
+
+    frost_ctx* ctx = frost_thread_ctx();
+    if (ctx == NULL) {
+        LOGE("Operation context could not be allocated");
+        return false;
+    }
+
+    message_source m = open_message(fd);
+    alloc_phase previous = alloc_phase_enter(ALLOC_PHASE_VERIFY);
+    bool verified = verify_signature_stream(global_signature, global_hash, &m,
+                                            global_participants[index].public_key, ctx);
+    alloc_phase_enter(previous);
+    message_release(&m);
+    if (!verified) {
+        LOGE("Signature verification failed for participant %d", index);
+    }
+    return verified;
+}
+
+bool verify_signing_fd_prehashed(int fd, int threads, int index) {
+    if (global_participants == NULL) {
+        LOGE("Participants not initialized");
+        return false;
+    }
+
+    if (index < 0 || index >= global_participants_count) {
+        LOGE("Invalid participant index: %d", index);
+        return false;
+    }
+
+    frost_ctx* ctx = frost_thread_ctx();
+    if (ctx == NULL) {
+        LOGE("Operation context could not be allocated");
+        return false;
+    }
+
+    message_source m = open_message(fd);
+    alloc_phase previous = alloc_phase_enter(ALLOC_PHASE_VERIFY);
+    bool verified = verify_signature_prehashed(global_signature, global_hash, &m, threads,
+                                               global_participants[index].public_key, ctx);
+    alloc_phase_enter(previous);
+    message_release(&m);
+    if (!verified) {
+        LOGE("Signature verification failed for participant %d", index);
+    }
+    return verified;
+}
+
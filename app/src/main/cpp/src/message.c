@@ -0,0 +1,127 @@
+#include "../headers/message.h"
+
+#include "../boringssl/include/openssl/mem.h"
+#include "../boringssl/include/openssl/sha.h"
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// read size for fd and callback sources
+#define MESSAGE_CHUNK (64 * 1024)
+
+// mapped files are hashed in windows of this size, dropped once absorbed
+#define MESSAGE_WINDOW (4 * 1024 * 1024)
+
+message_source message_from_buffer(const uint8_t* data, size_t size) {
+  return (message_source){.kind = MESSAGE_BUFFER, .data = data, .size = size,
+                          .fd = -1, .start = -1};
+}
+
+message_source message_from_fd(int fd) {
+  return (message_source){.kind = MESSAGE_FD, .fd = fd,
+                          .start = lseek(fd, 0, SEEK_CUR)};
+}
+
+message_source message_from_callback(message_read_fn read, void* arg) {
+  return (message_source){.kind = MESSAGE_CALLBACK, .read = read, .arg = arg,
+                          .fd = -1, .start = -1};
+}
+
+bool message_map_fd(int fd, message_source* out) {
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    return false;
+  }
+
+  *out = message_from_buffer(NULL, (size_t)st.st_size);
+  out->kind = MESSAGE_MAPPED;
+  if (st.st_size == 0) {
+    return true;  // nothing to map
+  }
+
+  void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+  out->data = data;
+  return true;
+}
+
+void message_release(message_source* m) {
+  if (m->kind == MESSAGE_MAPPED && m->data != NULL) {
+    munmap((void*)m->data, m->size);
+  }
+  m->data = NULL;
+  m->size = 0;
+}
+
+bool message_rewind(const message_source* m) {
+  switch (m->kind) {
+    case MESSAGE_BUFFER:
+    case MESSAGE_MAPPED:
+      return true;
+    case MESSAGE_FD:
+      return m->start >= 0 && lseek(m->fd, m->start, SEEK_SET) == m->start;
+    case MESSAGE_CALLBACK:
+      return false;
+  }
+  return false;
+}
+
+static bool absorb_mapped(SHA256_CTX* sha, const message_source* m) {
+  long page = sysconf(_SC_PAGESIZE);
+  for (size_t off = 0; off < m->size; off += MESSAGE_WINDOW) {
+    size_t len = m->size - off < MESSAGE_WINDOW ? m->size - off : MESSAGE_WINDOW;
+    SHA256_Update(sha, m->data + off, len);
+    // the window is clean and file-backed: give its pages back right away
+    if (page > 0) {
+      madvise((void*)(m->data + off), len - len % (size_t)page, MADV_DONTNEED);
+    }
+  }
+  return true;
+}
+
+static bool absorb_reader(SHA256_CTX* sha, const message_source* m,
+                          uint64_t* size) {
+  uint8_t* buf = OPENSSL_malloc(MESSAGE_CHUNK);
+  if (buf == NULL) {
+    return false;
+  }
+
+  bool ok = true;
+  for (;;) {
+    ssize_t got = m->kind == MESSAGE_FD ? read(m->fd, buf, MESSAGE_CHUNK)
+                                        : m->read(m->arg, buf, MESSAGE_CHUNK);
+    if (got < 0 && m->kind == MESSAGE_FD && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      ok = got == 0;
+      break;
+    }
+    SHA256_Update(sha, buf, (size_t)got);
+    *size += (uint64_t)got;
+  }
+
+  OPENSSL_free(buf);
+  return ok;
+}
+
+bool message_absorb(SHA256_CTX* sha, const message_source* m, uint64_t* size) {
+  *size = 0;
+  switch (m->kind) {
+    case MESSAGE_BUFFER:
+      SHA256_Update(sha, m->data, m->size);
+      *size = m->size;
+      return true;
+    case MESSAGE_MAPPED:
+      *size = m->size;
+      return absorb_mapped(sha, m);
+    case MESSAGE_FD:
+    case MESSAGE_CALLBACK:
+      return absorb_reader(sha, m, size);
+  }
+  return false;
+}
@@ -0,0 +1,190 @@
+#include "../headers/msm.h"
+
+#include "../boringssl/include/openssl/ec.h"
+#include "../boringssl/include/openssl/mem.h"
+#include <stdlib.h>
+
+
+#define STRAUS_WINDOW 4
+#define STRAUS_TABLE ((1 << STRAUS_WINDOW) - 1)
+
+msm_scratch* msm_scratch_new() {
+  return OPENSSL_zalloc(sizeof(msm_scratch));
+}
+
+void msm_scratch_free(msm_scratch* scratch) {
+  if (scratch == NULL) return;
+  for (size_t i = 0; i < scratch->cap; i++) {
+    EC_POINT_free(scratch->pool[i]);
+  }
+  for (size_t i = 0; i < scratch->decoded_cap; i++) {
+    EC_POINT_free(scratch->decoded[i]);
+  }
+  OPENSSL_free(scratch->pool);
+  OPENSSL_free(scratch->decoded);
+  OPENSSL_free(scratch->limbs);
+  OPENSSL_free(scratch);
+}
+
+static bool scratch_reserve(msm_scratch* scratch, size_t points,
+                            size_t scalars) {
+  if (points > scratch->cap) {
+    EC_POINT** pool =
+        OPENSSL_realloc(scratch->pool, sizeof(EC_POINT*) * points);
+    if (pool == NULL) return false;
+    scratch->pool = pool;
+    for (; scratch->cap < points; scratch->cap++) {
+      pool[scratch->cap] = EC_POINT_new(EC_group_p256());
+      if (pool[scratch->cap] == NULL) return false;
+    }
+  }
+  if (scalars > scratch->limbs_cap) {
+    OPENSSL_free(scratch->limbs);
+    scratch->limbs = OPENSSL_malloc(sizeof(uint64_t[4]) * scalars);
+    scratch->limbs_cap = scratch->limbs ? scalars : 0;
+    if (scratch->limbs == NULL) return false;
+  }
+  return true;
+}
+
+static bool decoded_reserve(msm_scratch* scratch, size_t points) {
+  if (points > scratch->decoded_cap) {
+    EC_POINT** decoded =
+        OPENSSL_realloc(scratch->decoded, sizeof(EC_POINT*) * points);
+    if (decoded == NULL) return false;
+    scratch->decoded = decoded;
+    for (; scratch->decoded_cap < points; scratch->decoded_cap++) {
+      decoded[scratch->decoded_cap] = EC_POINT_new(EC_group_p256());
+      if (decoded[scratch->decoded_cap] == NULL) return false;
+    }
+  }
+  return true;
+}
+
+/* width bits of k starting at bit; bits past 255 read as zero */
+static unsigned window_bits(const uint64_t k[4], unsigned bit, unsigned width) {
+  unsigned limb = bit / 64, shift = bit % 64;
+  uint64_t w = k[limb] >> shift;
+  if (shift + width > 64 && limb < 3) {
+    w |= k[limb + 1] << (64 - shift);
+  }
+  return (unsigned)(w & ((1u << width) - 1));
+}
+
+/* Straus: per-point tables of 1P..15P, one shared chain of doublings */
+static bool msm_straus(EC_POINT* out, const EC_POINT* const* points,
+                       const uint64_t (*limbs)[4], size_t count,
+                       EC_POINT** table, frost_ctx* ctx) {
+  const EC_GROUP* group = ctx->group;
+  BN_CTX* bn = ctx->bn;
+  bool ok = true;
+  for (size_t i = 0; ok && i < count; i++) {
+    EC_POINT** t = &table[i * STRAUS_TABLE];
+    ok = EC_POINT_copy(t[0], points[i]);
+    for (int d = 2; ok && d <= STRAUS_TABLE; d++) {
+      ok = (d & 1)
+               ? EC_POINT_add(group, t[d - 1], t[d - 2], points[i], bn)
+               : EC_POINT_dbl(group, t[d - 1], t[d / 2 - 1], bn);
+    }
+  }
+
+  ok = ok && EC_POINT_set_to_infinity(group, out);
+  for (int win = 256 / STRAUS_WINDOW - 1; ok && win >= 0; win--) {
+    for (int k = 0; ok && k < STRAUS_WINDOW; k++) {
+      ok = EC_POINT_dbl(group, out, out, bn);
+    }
+    for (size_t i = 0; ok && i < count; i++) {
+      unsigned d = window_bits(limbs[i], win * STRAUS_WINDOW, STRAUS_WINDOW);
+      if (d) {
+        ok = EC_POINT_add(group, out, out, table[i * STRAUS_TABLE + d - 1], bn);
+      }
+    }
+  }
+  return ok;
+}
+
+static unsigned pippenger_window(size_t count) {
+  unsigned c = 4;
+  while (c < 16 && ((size_t)1 << (c + 3)) < count) {
+    c++;
+  }
+  return c;
+}
+
+/* Pippenger: per window, drop every point into the bucket of its digit and
+ * fold the buckets with a running sum, so each point costs one addition. */
+static bool msm_pippenger(EC_POINT* out, const EC_POINT* const* points,
+                          const uint64_t (*limbs)[4], size_t count,
+                          unsigned c, EC_POINT** pool, frost_ctx* ctx) {
+  const EC_GROUP* group = ctx->group;
+  BN_CTX* bn = ctx->bn;
+  size_t buckets = ((size_t)1 << c) - 1;
+  EC_POINT** bucket = pool;
+  EC_POINT* running = pool[buckets];
+  EC_POINT* window_sum = pool[buckets + 1];
+  unsigned windows = (256 + c - 1) / c;
+
+  bool ok = EC_POINT_set_to_infinity(group, out);
+  for (int w = windows - 1; ok && w >= 0; w--) {
+    for (unsigned k = 0; ok && k < c; k++) {
+      ok = EC_POINT_dbl(group, out, out, bn);
+    }
+    for (size_t b = 0; ok && b < buckets; b++) {
+      ok = EC_POINT_set_to_infinity(group, bucket[b]);
+    }
+    for (size_t i = 0; ok && i < count; i++) {
+      unsigned d = window_bits(limbs[i], w * c, c);
+      if (d) {
+        ok = EC_POINT_add(group, bucket[d - 1], bucket[d - 1], points[i], bn);
+      }
+    }
+
+    // Σ d * bucket[d - 1] as a sum of suffix sums
+    ok = ok && EC_POINT_set_to_infinity(group, running) &&
+         EC_POINT_set_to_infinity(group, window_sum);
+    for (size_t b = buckets; ok && b-- > 0;) {
+      ok = EC_POINT_add(group, running, running, bucket[b], bn) &&
+           EC_POINT_add(group, window_sum, window_sum, running, bn);
+    }
+    ok = ok && EC_POINT_add(group, out, out, window_sum, bn);
+  }
+  return ok;
+}
+
+bool msm(EC_POINT* out, const EC_POINT* const* points, const scalar* scalars,
+         size_t count, frost_ctx* ctx) {
+  msm_scratch* scratch = ctx->scratch;
+
+  bool pippenger = count >= MSM_PIPPENGER_THRESHOLD;
+  unsigned c = pippenger ? pippenger_window(count) : 0;
+  size_t pool_size =
+      pippenger ? ((size_t)1 << c) + 1 : count * STRAUS_TABLE;
+
+  bool ok = scratch_reserve(scratch, pool_size, count);
+  for (size_t i = 0; ok && i < count; i++) {
+    scalar_to_limbs(scratch->limbs[i], &scalars[i]);
+  }
+
+  if (ok) {
+    ok = pippenger ? msm_pippenger(out, points,
+                                   (const uint64_t (*)[4])scratch->limbs,
+                                   count, c, scratch->pool, ctx)
+                   : msm_straus(out, points,
+                                (const uint64_t (*)[4])scratch->limbs, count,
+                                scratch->pool, ctx);
+  }
+  return ok;
+}
+
+bool msm_encoded(EC_POINT* out, const uint8_t* const* points,
+                 size_t point_bytes, const scalar* scalars, size_t count,
+                 frost_ctx* ctx) {
+  msm_scratch* scratch = ctx->scratch;
+  bool ok = decoded_reserve(scratch, count);
+  for (size_t i = 0; ok && i < count; i++) {
+    ok = EC_POINT_oct2point(ctx->group, scratch->decoded[i], points[i],
+                            point_bytes, ctx->bn);
+  }
+  return ok && msm(out, (const EC_POINT* const*)scratch->decoded, scalars,
+                   count, ctx);
+}
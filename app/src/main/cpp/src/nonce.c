@@ -0,0 +1,303 @@
+#include "../headers/nonce.h"
+
+#include "../boringssl/include/openssl/mem.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../headers/context.h"
+#include "../headers/drbg.h"
+#include "../headers/group.h"
+
+#define NONCE_FILE_MAGIC "FROST-P256-nonce"
+#define NONCE_FILE_VERSION 1
+
+struct nonce_file_header {
+  char magic[16];
+  uint32_t version;
+  uint32_t scalar_size;  // pairs are kept in their in-memory form
+  uint64_t capacity;
+  uint64_t generated;    // published pairs; only ever grows
+};
+
+/* Offsets of the file sections, each page aligned:
+ * header | used[capacity] | hiding[capacity] | binding[capacity] |
+ * commitments[capacity] */
+typedef struct {
+  size_t used;
+  size_t hiding;
+  size_t binding;
+  size_t commitments;
+  size_t size;
+} nonce_layout;
+
+static size_t page_size() {
+  long page = sysconf(_SC_PAGESIZE);
+  return page > 0 ? (size_t)page : 4096;
+}
+
+static size_t round_page(size_t n) {
+  size_t page = page_size();
+  return (n + page - 1) / page * page;
+}
+
+static nonce_layout layout_for(size_t capacity) {
+  nonce_layout l;
+  l.used = round_page(sizeof(nonce_file_header));
+  l.hiding = l.used + round_page(capacity);
+  l.binding = l.hiding + round_page(sizeof(scalar) * capacity);
+  l.commitments = l.binding + round_page(sizeof(scalar) * capacity);
+  l.size = l.commitments + round_page(2 * NONCE_POINT_BYTES * capacity);
+  return l;
+}
+
+/* Writes [data, data + len) of a mapped store back to its file; nothing to do
+ * for an in-memory store */
+static bool sync_range(const nonce_store* store, const void* data, size_t len,
+                       bool wait) {
+  if (store->map == NULL) {
+    return true;
+  }
+  size_t off = (size_t)((const uint8_t*)data - store->map);
+  size_t start = off - off % page_size();
+  return msync(store->map + start, off + len - start,
+               wait ? MS_SYNC : MS_ASYNC) == 0;
+}
+
+size_t nonce_store_published(const nonce_store* store) {
+  if (store->header != NULL) {
+    return (size_t)__atomic_load_n(&store->header->generated,
+                                   __ATOMIC_ACQUIRE);
+  }
+  return store->generated;
+}
+
+nonce_store* nonce_store_new(size_t capacity) {
+  nonce_store* store = OPENSSL_zalloc(sizeof(nonce_store));
+  if (store == NULL) {
+    return NULL;
+  }
+
+  store->fd = -1;
+  store->capacity = capacity;
+  store->hiding = OPENSSL_malloc(sizeof(scalar) * capacity);
+  store->binding = OPENSSL_malloc(sizeof(scalar) * capacity);
+  store->commitments = OPENSSL_malloc(2 * NONCE_POINT_BYTES * capacity);
+  store->used = OPENSSL_zalloc(capacity);
+  if (capacity > 0 && (!store->hiding || !store->binding ||
+                       !store->commitments || !store->used)) {
+    nonce_store_free(store);
+    return NULL;
+  }
+  return store;
+}
+
+// A zero-filled file of the right size with a header and nothing published
+static bool create_file(int fd, size_t capacity) {
+  nonce_file_header header = {.version = NONCE_FILE_VERSION,
+                              .scalar_size = sizeof(scalar),
+                              .capacity = capacity};
+  memcpy(header.magic, NONCE_FILE_MAGIC, sizeof(header.magic));
+  return ftruncate(fd, (off_t)layout_for(capacity).size) == 0 &&
+         pwrite(fd, &header, sizeof(header), 0) == sizeof(header) &&
+         fsync(fd) == 0;
+}
+
+static bool valid_header(const nonce_file_header* header, off_t file_size) {
+  return memcmp(header->magic, NONCE_FILE_MAGIC, sizeof(header->magic)) == 0 &&
+         header->version == NONCE_FILE_VERSION &&
+         header->scalar_size == sizeof(scalar) && header->capacity > 0 &&
+         header->capacity <= UINT32_MAX &&
+         header->generated <= header->capacity &&
+         (uint64_t)file_size >= layout_for(header->capacity).size;
+}
+
+nonce_store* nonce_store_open(const char* path, size_t capacity) {
+  if (capacity == 0 || capacity > UINT32_MAX) {
+    return NULL;
+  }
+  int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  // the lock keeps a second process from seeing a half-created file
+  nonce_file_header header;
+  struct stat st;
+  bool ok = flock(fd, LOCK_EX) == 0 && fstat(fd, &st) == 0;
+  if (ok && st.st_size == 0) {
+    ok = create_file(fd, capacity) && fstat(fd, &st) == 0;
+  }
+  ok = ok && pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+       valid_header(&header, st.st_size);
+
+  nonce_layout l = layout_for(ok ? header.capacity : 0);
+  void* map = ok ? mmap(NULL, l.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                 : MAP_FAILED;
+  flock(fd, LOCK_UN);
+  nonce_store* store = map != MAP_FAILED ? OPENSSL_zalloc(sizeof(nonce_store))
+                                         : NULL;
+  if (store == NULL) {
+    if (map != MAP_FAILED) {
+      munmap(map, l.size);
+    }
+    close(fd);
+    return NULL;
+  }
+#ifdef MADV_DONTDUMP
+  madvise(map, l.size, MADV_DONTDUMP);  // keep the nonces out of core dumps
+#endif
+
+  store->fd = fd;
+  store->map = map;
+  store->map_size = l.size;
+  store->header = map;
+  store->capacity = (size_t)header.capacity;
+  store->used = store->map + l.used;
+  store->hiding = (scalar*)(store->map + l.hiding);
+  store->binding = (scalar*)(store->map + l.binding);
+  store->commitments = (void*)(store->map + l.commitments);
+  store->generated = nonce_store_published(store);
+  for (size_t j = 0; j < store->generated; j++) {
+    store->remaining += !nonce_store_is_used(store, (uint32_t)j);
+  }
+  return store;
+}
+
+void nonce_store_free(nonce_store* store) {
+  if (store == NULL) {
+    return;
+  }
+  if (store->map != NULL) {
+    munmap(store->map, store->map_size);
+    close(store->fd);
+    OPENSSL_free(store);
+    return;
+  }
+
+  if (store->hiding && store->binding) {
+    OPENSSL_cleanse(store->hiding, sizeof(scalar) * store->generated);
+    OPENSSL_cleanse(store->binding, sizeof(scalar) * store->generated);
+  }
+  OPENSSL_free(store->hiding);
+  OPENSSL_free(store->binding);
+  OPENSSL_free(store->commitments);
+  OPENSSL_free(store->used);
+  OPENSSL_free(store);
+}
+
+// D_j and E_j for the pairs [first, first + count)
+static bool commit_pairs(nonce_store* store, size_t first, size_t count,
+                         frost_ctx* ctx) {
+  EC_POINT** points = OPENSSL_zalloc(sizeof(EC_POINT*) * 2 * count);
+  bool ok = points != NULL;
+  for (size_t j = 0; ok && j < 2 * count; j++) {
+    points[j] = group_point_new();
+    ok = points[j] != NULL;
+  }
+
+  ok = ok &&
+       group_base_mul_batch(points, store->hiding + first, count, ctx) &&
+       group_base_mul_batch(points + count, store->binding + first, count,
+                            ctx);
+  for (size_t j = 0; ok && j < count; j++) {
+    for (int k = 0; ok && k < 2; k++) {
+      ok = EC_POINT_point2oct(ctx->group, points[k * count + j],
+                              POINT_CONVERSION_UNCOMPRESSED,
+                              store->commitments[first + j][k],
+                              NONCE_POINT_BYTES, ctx->bn) == NONCE_POINT_BYTES;
+    }
+  }
+
+  for (size_t j = 0; points && j < 2 * count; j++) {
+    EC_POINT_free(points[j]);
+  }
+  OPENSSL_free(points);
+  return ok;
+}
+
+bool nonce_store_generate(nonce_store* store, size_t count, uint32_t* first_id,
+                          frost_ctx* ctx) {
+  // one generator at a time per file; takers need no lock
+  if (store->map != NULL && flock(store->fd, LOCK_EX) != 0) {
+    return false;
+  }
+
+  // another process may have published pairs since we last looked
+  size_t first = nonce_store_published(store);
+  store->remaining += first - store->generated;
+  store->generated = first;
+
+  bool ok = count <= store->capacity - first &&
+            random_scalars(ctx->rng, store->hiding + first, count) &&
+            random_scalars(ctx->rng, store->binding + first, count) &&
+            commit_pairs(store, first, count, ctx);
+
+  // pairs and commitments are on disk before the count moves past them
+  ok = ok &&
+       sync_range(store, store->hiding + first, sizeof(scalar) * count, true) &&
+       sync_range(store, store->binding + first, sizeof(scalar) * count,
+                  true) &&
+       sync_range(store, store->commitments + first,
+                  2 * NONCE_POINT_BYTES * count, true);
+  if (ok) {
+    store->generated = first + count;
+    store->remaining += count;
+    if (store->header != NULL) {
+      __atomic_store_n(&store->header->generated, (uint64_t)store->generated,
+                       __ATOMIC_RELEASE);
+      ok = sync_range(store, store->header, sizeof(nonce_file_header), true);
+    }
+    *first_id = (uint32_t)first;
+  }
+
+  if (store->map != NULL) {
+    flock(store->fd, LOCK_UN);
+  }
+  return ok;
+}
+
+bool nonce_store_commitment(const nonce_store* store, uint32_t id,
+                            EC_POINT* hiding, EC_POINT* binding,
+                            frost_ctx* ctx) {
+  return id < nonce_store_published(store) &&
+         EC_POINT_oct2point(ctx->group, hiding, store->commitments[id][0],
+                            NONCE_POINT_BYTES, ctx->bn) &&
+         EC_POINT_oct2point(ctx->group, binding, store->commitments[id][1],
+                            NONCE_POINT_BYTES, ctx->bn);
+}
+
+bool nonce_store_is_used(const nonce_store* store, uint32_t id) {
+  return id < nonce_store_published(store) &&
+         __atomic_load_n(&store->used[id], __ATOMIC_ACQUIRE) != 0;
+}
+
+bool nonce_store_take(nonce_store* store, uint32_t id, scalar* hiding,
+                      scalar* binding) {
+  uint8_t unused = 0;
+  if (id >= nonce_store_published(store) ||
+      !__atomic_compare_exchange_n(&store->used[id], &unused, 1, false,
+                                   __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+
+  // the marker is durable before the pair is used: a failure from here on
+  // loses the pair, never reuses it
+  if (!sync_range(store, &store->used[id], 1, true)) {
+    return false;
+  }
+  if (store->remaining > 0) {
+    store->remaining--;
+  }
+
+  *hiding = store->hiding[id];
+  *binding = store->binding[id];
+  scalar_cleanse(&store->hiding[id]);
+  scalar_cleanse(&store->binding[id]);
+  sync_range(store, &store->hiding[id], sizeof(scalar), false);
+  sync_range(store, &store->binding[id], sizeof(scalar), false);
+  return true;
+}
@@ -0,0 +1,199 @@
+#include "../headers/prehash.h"
+
+#include "../boringssl/include/openssl/mem.h"
+#include "../boringssl/include/openssl/sha.h"
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define PREHASH_MAX_THREADS 64
+
+// chunks each thread hashes per batch; bounds the staging buffer of fd and
+// callback sources to threads * PREHASH_PER_THREAD chunks
+#define PREHASH_PER_THREAD 4
+
+#define DIGEST SHA256_DIGEST_LENGTH
+
+/* Leaves [first, first + count) of one batch */
+typedef struct {
+  const uint8_t* data;
+  size_t len;  // bytes in the whole batch
+  size_t first;
+  size_t count;
+  uint8_t (*leaves)[DIGEST];
+} leaf_job;
+
+/* Merkle tree folded as it grows: at most one pending subtree per height */
+typedef struct {
+  uint8_t digest[64][DIGEST];
+  int height[64];
+  int depth;
+} merkle_stack;
+
+static void hash_node(uint8_t out[DIGEST], const uint8_t left[DIGEST],
+                      const uint8_t right[DIGEST]) {
+  static const uint8_t prefix = 0x01;
+  SHA256_CTX sha;
+  SHA256_Init(&sha);
+  SHA256_Update(&sha, &prefix, 1);
+  SHA256_Update(&sha, left, DIGEST);
+  SHA256_Update(&sha, right, DIGEST);
+  SHA256_Final(out, &sha);
+}
+
+static void* hash_leaves(void* arg) {
+  static const uint8_t prefix = 0x00;
+  leaf_job* job = arg;
+  for (size_t i = job->first; i < job->first + job->count; i++) {
+    size_t off = i * PREHASH_CHUNK;
+    size_t len = job->len - off < PREHASH_CHUNK ? job->len - off : PREHASH_CHUNK;
+    SHA256_CTX sha;
+    SHA256_Init(&sha);
+    SHA256_Update(&sha, &prefix, 1);
+    SHA256_Update(&sha, job->data + off, len);
+    SHA256_Final(job->leaves[i], &sha);
+  }
+  return NULL;
+}
+
+static void merkle_push(merkle_stack* st, const uint8_t leaf[DIGEST]) {
+  memcpy(st->digest[st->depth], leaf, DIGEST);
+  st->height[st->depth++] = 0;
+  // two complete subtrees of the same height become one
+  while (st->depth > 1 &&
+         st->height[st->depth - 1] == st->height[st->depth - 2]) {
+    st->depth--;
+    hash_node(st->digest[st->depth - 1], st->digest[st->depth - 1],
+              st->digest[st->depth]);
+    st->height[st->depth - 1]++;
+  }
+}
+
+/* The pending subtrees are strictly shrinking left to right; folding them
+ * from the right gives the same root as pairing level by level. */
+static void merkle_root(merkle_stack* st, uint8_t root[DIGEST]) {
+  while (st->depth > 1) {
+    st->depth--;
+    hash_node(st->digest[st->depth - 1], st->digest[st->depth - 1],
+              st->digest[st->depth]);
+  }
+  memcpy(root, st->digest[0], DIGEST);
+}
+
+/* Leaf digests of one batch, spread over up to `threads` threads */
+static void hash_batch(const uint8_t* data, size_t len, size_t chunks,
+                       size_t threads, uint8_t (*leaves)[DIGEST]) {
+  leaf_job jobs[PREHASH_MAX_THREADS];
+  pthread_t tids[PREHASH_MAX_THREADS];
+  bool started[PREHASH_MAX_THREADS];
+  size_t workers = threads < chunks ? threads : chunks;
+
+  size_t first = 0;
+  for (size_t w = 0; w < workers; w++) {
+    size_t count = chunks / workers + (w < chunks % workers ? 1 : 0);
+    jobs[w] = (leaf_job){.data = data, .len = len, .first = first,
+                         .count = count, .leaves = leaves};
+    first += count;
+  }
+
+  for (size_t w = 1; w < workers; w++) {
+    started[w] = pthread_create(&tids[w], NULL, hash_leaves, &jobs[w]) == 0;
+  }
+  hash_leaves(&jobs[0]);
+  for (size_t w = 1; w < workers; w++) {
+    if (started[w]) {
+      pthread_join(tids[w], NULL);
+    } else {
+      hash_leaves(&jobs[w]);
+    }
+  }
+}
+
+/* Reads until want bytes or the end of the source; -1 on error */
+static ssize_t fill_batch(const message_source* m, uint8_t* buf, size_t want) {
+  size_t have = 0;
+  while (have < want) {
+    ssize_t got = m->kind == MESSAGE_FD
+                      ? read(m->fd, buf + have, want - have)
+                      : m->read(m->arg, buf + have, want - have);
+    if (got < 0 && m->kind == MESSAGE_FD && errno == EINTR) {
+      continue;
+    }
+    if (got < 0) {
+      return -1;
+    }
+    if (got == 0) {
+      break;
+    }
+    have += (size_t)got;
+  }
+  return (ssize_t)have;
+}
+
+static void put_be64(uint8_t* out, uint64_t v) {
+  for (int i = 0; i < 8; i++) {
+    out[i] = (uint8_t)(v >> (56 - 8 * i));
+  }
+}
+
+bool prehash_message(const message_source* m, int threads,
+                     uint8_t out[PREHASH_BYTES]) {
+  size_t workers = threads > 1 ? (size_t)threads : 1;
+  if (workers > PREHASH_MAX_THREADS) workers = PREHASH_MAX_THREADS;
+  size_t batch_chunks = workers * PREHASH_PER_THREAD;
+  size_t batch_bytes = batch_chunks * PREHASH_CHUNK;
+
+  bool in_memory = m->kind == MESSAGE_BUFFER || m->kind == MESSAGE_MAPPED;
+  uint8_t(*leaves)[DIGEST] = OPENSSL_malloc(DIGEST * batch_chunks);
+  uint8_t* staging = in_memory ? NULL : OPENSSL_malloc(batch_bytes);
+  merkle_stack* st = OPENSSL_zalloc(sizeof(merkle_stack));
+  bool ok = leaves && st && (in_memory || staging);
+
+  uint64_t total = 0;
+  for (bool first = true; ok; first = false) {
+    const uint8_t* data;
+    size_t len;
+    if (in_memory) {
+      data = m->data + total;
+      len = m->size - total < batch_bytes ? m->size - total : batch_bytes;
+    } else {
+      ssize_t got = fill_batch(m, staging, batch_bytes);
+      ok = got >= 0;
+      data = staging;
+      len = ok ? (size_t)got : 0;
+    }
+    if (!ok || (len == 0 && !first)) {
+      break;
+    }
+
+    // an empty message is a single empty leaf
+    size_t chunks = len == 0 ? 1 : (len + PREHASH_CHUNK - 1) / PREHASH_CHUNK;
+    hash_batch(data, len, chunks, workers, leaves);
+    for (size_t i = 0; i < chunks; i++) {
+      merkle_push(st, leaves[i]);
+    }
+
+    // hashed pages of a mapping are clean; drop them (chunks are page sized)
+    if (m->kind == MESSAGE_MAPPED && len == batch_bytes) {
+      madvise((void*)data, len, MADV_DONTNEED);
+    }
+    total += len;
+    if (len < batch_bytes) {
+      break;
+    }
+  }
+
+  if (ok) {
+    memcpy(out, PREHASH_TAG, PREHASH_TAG_LEN);
+    put_be64(out + PREHASH_TAG_LEN, PREHASH_CHUNK);
+    put_be64(out + PREHASH_TAG_LEN + 8, total);
+    merkle_root(st, out + PREHASH_TAG_LEN + 16);
+  }
+
+  OPENSSL_free(leaves);
+  OPENSSL_free(staging);
+  OPENSSL_free(st);
+  return ok;
+}
@@ -0,0 +1,52 @@
+#include "../headers/presence.h"
+
+#include <string.h>
+
+#define WORD_BITS 64
+
+static size_t word_count(size_t size) {
+  return (size + WORD_BITS - 1) / WORD_BITS;
+}
+
+bool presence_init(presence_map* map, session_arena* arena, size_t size) {
+  map->words = arena_alloc(arena, sizeof(uint64_t) * word_count(size));
+  map->size = size;
+  map->count = 0;
+  return map->words != NULL;
+}
+
+bool presence_test(const presence_map* map, size_t i) {
+  return i < map->size &&
+         (map->words[i / WORD_BITS] >> (i % WORD_BITS) & 1) != 0;
+}
+
+bool presence_add(presence_map* map, size_t i) {
+  if (i >= map->size || presence_test(map, i)) {
+    return false;
+  }
+  map->words[i / WORD_BITS] |= (uint64_t)1 << (i % WORD_BITS);
+  map->count++;
+  return true;
+}
+
+size_t presence_next(const presence_map* map, size_t i) {
+  if (i >= map->size) {
+    return map->size;
+  }
+  size_t w = i / WORD_BITS;
+  uint64_t bits = map->words[w] & (~(uint64_t)0 << (i % WORD_BITS));
+  while (bits == 0) {
+    if (++w == word_count(map->size)) {
+      return map->size;
+    }
+    bits = map->words[w];
+  }
+  return w * WORD_BITS + (size_t)__builtin_ctzll(bits);
+}
+
+void presence_clear(presence_map* map) {
+  if (map->words != NULL) {
+    memset(map->words, 0, sizeof(uint64_t) * word_count(map->size));
+  }
+  map->count = 0;
+}
@@ -0,0 +1,252 @@
+#include "../headers/scalar.h"
+
+#include "../boringssl/include/openssl/bn.h"
+#include "../boringssl/include/openssl/crypto.h"
+#include <string.h>
+
+typedef unsigned __int128 u128;
+
+// P-256 group order n, little-endian limbs
+static const uint64_t N[4] = {0xf3b9cac2fc632551ULL, 0xbce6faada7179e84ULL,
+                              0xffffffffffffffffULL, 0xffffffff00000000ULL};
+
+// -n^-1 mod 2^64
+static const uint64_t N0 = 0xccd1c8aaee00bc4fULL;
+
+// 2^512 mod n, used to enter the Montgomery domain
+static const uint64_t RR[4] = {0x83244c95be79eea2ULL, 0x4699799c49bd6fa6ULL,
+                               0x2845b2392b6bec59ULL, 0x66e12d94f3d95620ULL};
+
+// 2^256 mod n, i.e. one in Montgomery form
+static const uint64_t R1[4] = {0x0c46353d039cdaafULL, 0x4319055258e8617bULL,
+                               0x0000000000000000ULL, 0x00000000ffffffffULL};
+
+/* r = (hi:a) - n if that does not borrow, a otherwise. hi is the carry limb
+ * above a, so any value below 2n comes out fully reduced. */
+static void reduce_once(uint64_t r[4], const uint64_t a[4], uint64_t hi) {
+  uint64_t t[4];
+  u128 borrow = 0;
+  for (int i = 0; i < 4; i++) {
+    u128 d = (u128)a[i] - N[i] - borrow;
+    t[i] = (uint64_t)d;
+    borrow = (d >> 64) & 1;
+  }
+  // keep a when the subtraction borrowed past the carry limb
+  uint64_t keep = 0 - (uint64_t)(borrow & (hi ^ 1));
+  for (int i = 0; i < 4; i++) {
+    r[i] = (a[i] & keep) | (t[i] & ~keep);
+  }
+}
+
+/* Montgomery multiplication (CIOS): r = a * b * 2^-256 mod n */
+static void mont_mul(uint64_t r[4], const uint64_t a[4], const uint64_t b[4]) {
+  uint64_t t[6] = {0};
+
+  for (int i = 0; i < 4; i++) {
+    u128 c = 0;
+    for (int j = 0; j < 4; j++) {
+      c = (u128)a[j] * b[i] + t[j] + (uint64_t)(c >> 64);
+      t[j] = (uint64_t)c;
+    }
+    c = (u128)t[4] + (uint64_t)(c >> 64);
+    t[4] = (uint64_t)c;
+    t[5] = (uint64_t)(c >> 64);
+
+    uint64_t m = t[0] * N0;
+    c = (u128)m * N[0] + t[0];
+    for (int j = 1; j < 4; j++) {
+      c = (u128)m * N[j] + t[j] + (uint64_t)(c >> 64);
+      t[j - 1] = (uint64_t)c;
+    }
+    c = (u128)t[4] + (uint64_t)(c >> 64);
+    t[3] = (uint64_t)c;
+    t[4] = t[5] + (uint64_t)(c >> 64);
+  }
+
+  reduce_once(r, t, t[4]);
+}
+
+void scalar_zero(scalar* r) { memset(r->v, 0, sizeof(r->v)); }
+
+void scalar_one(scalar* r) { memcpy(r->v, R1, sizeof(r->v)); }
+
+void scalar_set_word(scalar* r, uint64_t w) {
+  uint64_t a[4] = {w, 0, 0, 0};
+  mont_mul(r->v, a, RR);
+}
+
+bool scalar_is_zero(const scalar* a) {
+  return (a->v[0] | a->v[1] | a->v[2] | a->v[3]) == 0;
+}
+
+bool scalar_equal(const scalar* a, const scalar* b) {
+  uint64_t diff = 0;
+  for (int i = 0; i < 4; i++) {
+    diff |= a->v[i] ^ b->v[i];
+  }
+  return diff == 0;
+}
+
+void scalar_add(scalar* r, const scalar* a, const scalar* b) {
+  uint64_t t[4];
+  u128 c = 0;
+  for (int i = 0; i < 4; i++) {
+    c = (u128)a->v[i] + b->v[i] + (uint64_t)(c >> 64);
+    t[i] = (uint64_t)c;
+  }
+  reduce_once(r->v, t, (uint64_t)(c >> 64));
+}
+
+void scalar_sub(scalar* r, const scalar* a, const scalar* b) {
+  uint64_t t[4];
+  u128 borrow = 0;
+  for (int i = 0; i < 4; i++) {
+    u128 d = (u128)a->v[i] - b->v[i] - borrow;
+    t[i] = (uint64_t)d;
+    borrow = (d >> 64) & 1;
+  }
+  // add n back when the subtraction went negative
+  uint64_t mask = 0 - (uint64_t)borrow;
+  u128 c = 0;
+  for (int i = 0; i < 4; i++) {
+    c = (u128)t[i] + (N[i] & mask) + (uint64_t)(c >> 64);
+    r->v[i] = (uint64_t)c;
+  }
+}
+
+void scalar_neg(scalar* r, const scalar* a) {
+  scalar z;
+  scalar_zero(&z);
+  scalar_sub(r, &z, a);
+}
+
+void scalar_mul(scalar* r, const scalar* a, const scalar* b) {
+  mont_mul(r->v, a->v, b->v);
+}
+
+void scalar_sqr(scalar* r, const scalar* a) { mont_mul(r->v, a->v, a->v); }
+
+void scalar_pow_word(scalar* r, const scalar* a, uint64_t e) {
+  scalar acc, base = *a;
+  scalar_one(&acc);
+  while (e) {
+    if (e & 1) {
+      scalar_mul(&acc, &acc, &base);
+    }
+    e >>= 1;
+    if (e) {
+      scalar_sqr(&base, &base);
+    }
+  }
+  *r = acc;
+}
+
+void scalar_inv(scalar* r, const scalar* a) {
+  // exponent n - 2, processed in 4-bit windows from the top
+  static const uint64_t E[4] = {0xf3b9cac2fc63254fULL, 0xbce6faada7179e84ULL,
+                                0xffffffffffffffffULL, 0xffffffff00000000ULL};
+  scalar table[16];
+  scalar_one(&table[0]);
+  table[1] = *a;
+  for (int i = 2; i < 16; i++) {
+    scalar_mul(&table[i], &table[i - 1], a);
+  }
+
+  scalar acc;
+  scalar_one(&acc);
+  for (int limb = 3; limb >= 0; limb--) {
+    for (int shift = 60; shift >= 0; shift -= 4) {
+      for (int k = 0; k < 4; k++) {
+        scalar_sqr(&acc, &acc);
+      }
+      scalar_mul(&acc, &acc, &table[(E[limb] >> shift) & 0xf]);
+    }
+  }
+
+  OPENSSL_cleanse(table, sizeof(table));
+  *r = acc;
+}
+
+void scalar_from_bytes(scalar* r, const uint8_t in[SCALAR_BYTES]) {
+  uint64_t t[4];
+  for (int i = 0; i < 4; i++) {
+    uint64_t w = 0;
+    for (int j = 0; j < 8; j++) {
+      w = (w << 8) | in[(3 - i) * 8 + j];
+    }
+    t[i] = w;
+  }
+  // any 256-bit value is below 2n, so one conditional subtraction reduces it
+  reduce_once(t, t, 0);
+  mont_mul(r->v, t, RR);
+}
+
+void scalar_from_wide(scalar* r, const uint8_t in[2 * SCALAR_BYTES]) {
+  // in = hi * 2^256 + lo; Montgomery form of hi * 2^256 is mont(hi * R, RR)
+  scalar hi, lo;
+  scalar_from_bytes(&hi, in);
+  scalar_from_bytes(&lo, in + SCALAR_BYTES);
+  mont_mul(hi.v, hi.v, RR);
+  scalar_add(r, &hi, &lo);
+}
+
+void scalar_to_limbs(uint64_t out[4], const scalar* a) {
+  static const uint64_t one[4] = {1, 0, 0, 0};
+  mont_mul(out, a->v, one);
+}
+
+void scalar_to_bytes(uint8_t out[SCALAR_BYTES], const scalar* a) {
+  uint64_t t[4];
+  scalar_to_limbs(t, a);
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 8; j++) {
+      out[(3 - i) * 8 + j] = (uint8_t)(t[i] >> (56 - 8 * j));
+    }
+  }
+}
+
+bool scalar_from_bn(scalar* r, const BIGNUM* bn) {
+  uint8_t buf[SCALAR_BYTES];
+
+  if (BN_is_negative(bn)) {
+    return false;
+  }
+
+  if (BN_num_bytes(bn) <= SCALAR_BYTES) {
+    if (!BN_bn2binpad(bn, buf, SCALAR_BYTES)) {
+      return false;
+    }
+    scalar_from_bytes(r, buf);
+    OPENSSL_cleanse(buf, sizeof(buf));
+    return true;
+  }
+
+  // wider inputs take the generic reduction once, then stay fixed-width
+  static const uint8_t n_be[SCALAR_BYTES] = {
+      0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xbc, 0xe6, 0xfa, 0xad, 0xa7, 0x17,
+      0x9e, 0x84, 0xf3, 0xb9, 0xca, 0xc2, 0xfc, 0x63, 0x25, 0x51};
+  BN_CTX* ctx = BN_CTX_new();
+  BIGNUM* n = BN_bin2bn(n_be, SCALAR_BYTES, NULL);
+  BIGNUM* tmp = BN_new();
+  bool ok = ctx && n && tmp && BN_nnmod(tmp, bn, n, ctx) &&
+            BN_bn2binpad(tmp, buf, SCALAR_BYTES);
+  if (ok) {
+    scalar_from_bytes(r, buf);
+  }
+  OPENSSL_cleanse(buf, sizeof(buf));
+  BN_clear_free(tmp);
+  BN_free(n);
+  BN_CTX_free(ctx);
+  return ok;
+}
+
+bool scalar_to_bn(const scalar* a, BIGNUM* out) {
+  uint8_t buf[SCALAR_BYTES];
+  scalar_to_bytes(buf, a);
+  bool ok = BN_bin2bn(buf, SCALAR_BYTES, out) != NULL;
+  OPENSSL_cleanse(buf, sizeof(buf));
+  return ok;
+}
+
+void scalar_cleanse(scalar* a) { OPENSSL_cleanse(a, sizeof(*a)); }
@@ -10,408 +10,330 @@
 #define LOG_TAG "SetupDebug"
 
 
+#include "../headers/arena.h"
+#include "../headers/commit_encoding.h"
+#include "../headers/commit_store.h"
+#include "../headers/context.h"
+#include "../headers/drbg.h"
 #include "../headers/globals.h"
+#include "../headers/group.h"
+#include "../headers/msm.h"
+#include "../headers/presence.h"
 
-void init_coeff_list(participant* p) {
+void init_coeff_list(participant* p, frost_ctx* ctx) {
     __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Initializing coefficient list for participant[%d]", p->index);
 
     int threshold = p->threshold;
-    p->list = malloc(sizeof(coeff_list));
+    p->list = arena_alloc(p->arena, sizeof(coeff_list));
     if (p->list == NULL) {
         __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to allocate memory for coefficient list");
         return;
     }
     p->list->coefficient_list_len = threshold;
-    p->list->coeff = OPENSSL_malloc(sizeof(BIGNUM*) * threshold);
+    p->list->coeff = arena_alloc(p->arena, sizeof(scalar) * threshold);
     if (p->list->coeff == NULL) {
         __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to allocate memory for coefficients");
         return;
     }
 
-    static bool is_initialized = false;
-
-    if (!is_initialized) {
-        __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Initializing curve parameters");
-        initialize_curve_parameters();
-        is_initialized = true;
-    }
-
-    // Fill the coefficient_list with random BIGNUMs
-    for (int i = 0; i < threshold; i++) {
-        p->list->coeff[i] = BN_new();
-        BIGNUM* rand = generate_rand();
-        if (rand == NULL) {
-            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to generate random BIGNUM");
-            return;
-        }
-        BN_copy(p->list->coeff[i], rand);
-        BN_clear_free(rand);
+    // Fill the coefficient_list with random scalars in one draw
+    if (!random_scalars(ctx->rng, p->list->coeff, threshold)) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to generate random scalars");
+        return;
     }
 
     __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Coefficient list initialized for participant[%d]", p->index);
 }
 
+// The polynomial is wiped as soon as the keys exist; the arena frees it later
 void free_coeff_list(participant* p) {
-  for (int i = 0; i < p->list->coefficient_list_len; i++) {
-    BN_clear_free(p->list->coeff[i]);
-  }
-  OPENSSL_free(p->list->coeff);
+  OPENSSL_cleanse(p->list->coeff,
+                  sizeof(scalar) * p->list->coefficient_list_len);
   p->list->coefficient_list_len = 0;
   p->list->coeff = NULL;
-  free(p->list);
   p->list = NULL;
 }
 
-pub_commit_packet* init_pub_commit(participant* p) {
+pub_commit_packet* init_pub_commit(participant* p, frost_ctx* ctx) {
     __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Initializing public commitment for participant[%d]", p->index);
 
     int threshold = p->threshold;
-    BN_CTX* ctx = BN_CTX_new();
-    if (ctx == NULL) {
-        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to create BN_CTX");
-        return NULL;
-    }
-
-    init_coeff_list(p);
+    init_coeff_list(p, ctx);
 
-    // allocate memory for the public commit array
-    p->pub_commit = malloc(sizeof(pub_commit_packet));
-    if (p->pub_commit == NULL) {
+    // allocate memory for the public commit packet and its encoded points
+    pub_commit_packet* commit = arena_alloc(p->arena, sizeof(pub_commit_packet));
+    uint8_t* encoded = arena_alloc(p->arena, COMMIT_POINT_BYTES * threshold);
+    if (commit == NULL || encoded == NULL) {
         __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to allocate memory for pub_commit");
-        BN_CTX_free(ctx);
         return NULL;
     }
-    p->pub_commit->sender_index = p->index;
-    p->pub_commit->commit_len = threshold;
-    p->pub_commit->commit = OPENSSL_malloc(sizeof(BIGNUM*) * threshold);
-    if (p->pub_commit->commit == NULL) {
-        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to allocate memory for commit array");
-        BN_CTX_free(ctx);
-        free(p->pub_commit);
-        return NULL;
+    commit->sender_index = p->index;
+    commit->commit_len = threshold;
+    commit->commit = encoded;
+
+    // G ^ a_i_j in temporary points, kept only in encoded form
+    EC_POINT** points = OPENSSL_zalloc(sizeof(EC_POINT*) * threshold);
+    bool ok = points != NULL;
+    for (int j = 0; ok && j < threshold; j++) {
+        points[j] = group_point_new();
+        ok = points[j] != NULL;
     }
-
-    // Fill with G ^ a_i_j
-    for (int j = 0; j < threshold; j++) {
-        BN_CTX_start(ctx);
-        p->pub_commit->commit[j] = BN_new();
-        BIGNUM* result = BN_new();
-        BN_mul(result, b_generator, p->list->coeff[j], ctx);
-        BN_copy(p->pub_commit->commit[j], result);
-        BN_CTX_end(ctx);
-        BN_clear_free(result);
+    ok = ok &&
+         group_base_mul_batch(points, p->list->coeff, threshold, ctx) &&
+         commit_points_encode(encoded, points, threshold, ctx);
+    for (int j = 0; points && j < threshold; j++) {
+        EC_POINT_free(points[j]);
+    }
+    OPENSSL_free(points);
+    if (!ok) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to compute commitments");
+        return NULL;
     }
+    p->pub_commit = commit;
 
-    BN_CTX_free(ctx);
     __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Public commitment initialized for participant[%d]", p->index);
     return p->pub_commit;
 }
 
-void free_pub_commit(pub_commit_packet* pub_commit) {
-  for (int i = 0; i < pub_commit->commit_len; i++) {
-    BN_clear_free(pub_commit->commit[i]);
+/* The share slots of p, one per sender index, allocated with the first
+ * share */
+static bool init_rcvd_slots(participant* p) {
+  if (p->rcvd_sec_shares != NULL) {
+    return true;
   }
-  OPENSSL_free(pub_commit->commit);
-  pub_commit->commit_len = 0;
-  pub_commit->sender_index = 0;
-  pub_commit->commit = NULL;
-}
-
-rcvd_pub_commits* create_node_commit(pub_commit_packet* rcvd_packet) {
-  size_t commit_len = rcvd_packet->commit_len;
-
-  rcvd_pub_commits* newNode =
-      (rcvd_pub_commits*)malloc(sizeof(rcvd_pub_commits));
-  newNode->rcvd_packet = malloc(sizeof(pub_commit_packet));
-  newNode->rcvd_packet->commit = OPENSSL_malloc(sizeof(BIGNUM*) * commit_len);
-  newNode->next = NULL;
-
-  newNode->rcvd_packet->commit_len = rcvd_packet->commit_len;
-  newNode->rcvd_packet->sender_index = rcvd_packet->sender_index;
-  for (int j = 0; j < commit_len; j++) {
-    newNode->rcvd_packet->commit[j] = BN_new();
-    BN_copy(newNode->rcvd_packet->commit[j], rcvd_packet->commit[j]);
+  size_t n = p->participants;
+  scalar* shares = arena_alloc(p->arena, sizeof(scalar) * n);
+  if (!shares || !presence_init(&p->sec_shares_in, p->arena, n)) {
+    return false;
   }
-
-  return newNode;
+  p->rcvd_sec_shares = shares;
+  return true;
 }
 
-void insert_node_commit(participant* p, pub_commit_packet* rcvd_packet) {
-  rcvd_pub_commits* newNode = create_node_commit(rcvd_packet);
-  newNode->next = p->rcvd_commit_head;
-  p->rcvd_commit_head = newNode;
+static bool valid_sender(const participant* p, int sender_index) {
+  return sender_index >= 0 && sender_index < p->participants;
 }
 
-void free_rcvd_pub_commits(rcvd_pub_commits* head) {
-  if (head == NULL) {
-    return;
+// The commitment row of sender, NULL if it has not arrived
+const uint8_t* rcvd_commit(const participant* p, int sender_index) {
+  const uint8_t* row =
+      p->commits ? commit_store_row(p->commits, sender_index) : NULL;
+  if (row == NULL) {
+    printf("Sender's public commitment were not found!");
   }
-  free_rcvd_pub_commits(head->next);
-  for (int j = 0; j < head->rcvd_packet->commit_len; j++) {
-    BN_clear_free(head->rcvd_packet->commit[j]);
-  }
-  OPENSSL_free(head->rcvd_packet->commit);
-  free(head->rcvd_packet);
-  free(head);
+  return row;
 }
 
-pub_commit_packet* search_node_commit(rcvd_pub_commits* head,
-                                      int sender_index) {
-  rcvd_pub_commits* current = head;  // Initialize current
-  while (current != NULL) {
-    if (current->rcvd_packet->sender_index == sender_index)
-      return current->rcvd_packet;
-    current = current->next;
-  }
-  printf("Sender's public commitment were not found!");
+bool publish_pub_commit(commit_store* store, const pub_commit_packet* pub_commit,
+                        frost_ctx* ctx) {
+  return commit_store_publish(store, pub_commit->sender_index,
+                              pub_commit->commit, pub_commit->commit_len, ctx);
 }
 
-bool accept_pub_commit(participant* receiver, pub_commit_packet* pub_commit) {
+bool accept_pub_commit(participant* receiver, pub_commit_packet* pub_commit,
+                       frost_ctx* ctx) {
   /*1. P_i broadcast public commitment (whole list) to all participants P_j
   P_j saves it to matrix_rcvd_commits*/
 
-  if (receiver->rcvd_commit_head == NULL) {
-    receiver->rcvd_commit_head = create_node_commit(pub_commit);
-    return true;
-  } else {
-    insert_node_commit(receiver, pub_commit);
-    return true;
+  if (receiver->commits == NULL) {
+    receiver->commits =
+        commit_store_new(receiver->participants, receiver->threshold);
+    if (receiver->commits == NULL ||
+        (receiver->pub_commit != NULL &&
+         !publish_pub_commit(receiver->commits, receiver->pub_commit, ctx))) {
+      return false;
+    }
   }
-  return false;
+  // one commitment per sender, of t valid points: anything else is refused
+  return valid_sender(receiver, pub_commit->sender_index) &&
+         publish_pub_commit(receiver->commits, pub_commit, ctx);
 }
 
-BIGNUM* init_sec_share(participant* sender, int receiver_index) {
-    int threshold = sender->threshold;
-    BN_CTX* ctx = BN_CTX_new();
-    BN_CTX* ctx2 = BN_CTX_new();
-    if (!ctx || !ctx2) {
-        // Ensure proper cleanup if memory allocation fails
-        if (ctx) BN_CTX_free(ctx);
-        if (ctx2) BN_CTX_free(ctx2);
-        return NULL;
-    }
+bool accept_commit_store(participant* receiver, commit_store* store) {
+  if (receiver->commits != NULL ||
+      store->rows != (size_t)receiver->participants ||
+      store->threshold != (size_t)receiver->threshold) {
+    return false;
+  }
+  receiver->commits = commit_store_retain(store);
+  return true;
+}
 
-    BIGNUM* result = NULL;
+uint64_t participant_identifier(int index) {
+  return (uint64_t)index + 1;
+}
 
-    // Convert integer receiver_index to BIGNUM
-    BIGNUM* b_index = BN_new();
-    if (!b_index || !BN_set_word(b_index, receiver_index)) {
-        BN_clear_free(b_index);
-        BN_CTX_free(ctx);
-        BN_CTX_free(ctx2);
-        return NULL;
+/*
+# f_i(x) = ∑ a_i_j * x^j, 0 ≤ j ≤ t - 1, evaluated with Horner's rule
+*/
+static void poly_eval(const scalar* coeff, size_t threshold, uint64_t x,
+                      scalar* out) {
+    scalar b_x, acc;
+    scalar_set_word(&b_x, x);
+    acc = coeff[threshold - 1];
+    for (size_t j = threshold - 1; j-- > 0;) {
+        scalar_mul(&acc, &acc, &b_x);
+        scalar_add(&acc, &acc, &coeff[j]);
     }
+    *out = acc;
+    scalar_cleanse(&acc);
+}
 
-    // Use OpenSSL_malloc for OpenSSL compatibility
-    sender->func = OPENSSL_malloc(sizeof(poly));
-    if (!sender->func) {
-        BN_clear_free(b_index);
-        BN_CTX_free(ctx);
-        BN_CTX_free(ctx2);
-        return NULL;
+/*
+# f_i over consecutive points x0, x0 + 1, ..., x0 + len - 1 by forward
+# differences: after t Horner evaluations every further point costs t - 1
+# additions and no multiplications. diff holds t scalars of scratch.
+*/
+static void poly_eval_run(const scalar* coeff, size_t threshold, uint64_t x0,
+                          size_t len, scalar* diff, scalar* out) {
+    for (size_t j = 0; j < threshold; j++) {
+        poly_eval(coeff, threshold, x0 + j, &diff[j]);
     }
-    sender->func->n = threshold;
-
-    sender->func->t = OPENSSL_malloc(sizeof(term) * threshold);
-    if (!sender->func->t) {
-        OPENSSL_free(sender->func);
-        BN_clear_free(b_index);
-        BN_CTX_free(ctx);
-        BN_CTX_free(ctx2);
-        return NULL;
+    // diff[k] = Δ^k f(x0)
+    for (size_t k = 1; k < threshold; k++) {
+        for (size_t j = threshold - 1; j >= k; j--) {
+            scalar_sub(&diff[j], &diff[j], &diff[j - 1]);
+        }
     }
-
-    /*
-    # 1. Define a polynomial
-    # f_i(x) = ∑ a_i_j * x^j, 0 ≤ j ≤ t - 1
-    */
-    for (int i = 0; i < threshold; i++) {
-        sender->func->t[i].coefficient = BN_new();
-        if (!sender->func->t[i].coefficient ||
-            !BN_copy(sender->func->t[i].coefficient, sender->list->coeff[i])) {
-            // Cleanup on failure
-            for (int j = 0; j <= i; j++) {
-                if (sender->func->t[j].coefficient) {
-                    BN_clear_free(sender->func->t[j].coefficient);
-                }
-                if (sender->func->t[j].exponent) {
-                    BN_clear_free(sender->func->t[j].exponent);
-                }
-            }
-            OPENSSL_free(sender->func->t);
-            OPENSSL_free(sender->func);
-            BN_clear_free(b_index);
-            BN_CTX_free(ctx);
-            BN_CTX_free(ctx2);
-            return NULL;
+    for (size_t i = 0; i < len; i++) {
+        out[i] = diff[0];
+        for (size_t k = 0; k + 1 < threshold; k++) {
+            scalar_add(&diff[k], &diff[k], &diff[k + 1]);
         }
+    }
+}
 
-        // Convert integer exponent to BIGNUM
-        sender->func->t[i].exponent = BN_new();
-        if (!sender->func->t[i].exponent || !BN_set_word(sender->func->t[i].exponent, i)) {
-            for (int j = 0; j <= i; j++) {
-                BN_clear_free(sender->func->t[j].coefficient);
-                BN_clear_free(sender->func->t[j].exponent);
-            }
-            OPENSSL_free(sender->func->t);
-            OPENSSL_free(sender->func);
-            BN_clear_free(b_index);
-            BN_CTX_free(ctx);
-            BN_CTX_free(ctx2);
-            return NULL;
-        }
+bool init_sec_share(participant* sender, int receiver_index,
+                    scalar* sec_share) {
+    if (receiver_index < 0 || sender->list == NULL) {
+        return false;
     }
+    poly_eval(sender->list->coeff, sender->list->coefficient_list_len,
+              participant_identifier(receiver_index), sec_share);
+    return true;
+}
 
-    /*
-    # 2. Calculate a polynomial
-    # f_i(x) = ∑ a_i_j * x^j, 0 ≤ j ≤ t - 1
-    */
-    for (int i = 0; i < sender->func->n; i++) {
-        BIGNUM* expo_product = BN_new();
-        BIGNUM* multi_product = BN_new();
-        if (!expo_product || !multi_product) {
-            BN_clear_free(expo_product);
-            BN_clear_free(multi_product);
-            // Cleanup and free previous allocations
-            for (int j = 0; j < threshold; j++) {
-                BN_clear_free(sender->func->t[j].coefficient);
-                BN_clear_free(sender->func->t[j].exponent);
-            }
-            OPENSSL_free(sender->func->t);
-            OPENSSL_free(sender->func);
-            BN_clear_free(b_index);
-            BN_CTX_free(ctx);
-            BN_CTX_free(ctx2);
+scalar* init_sec_shares(participant* sender, const int* receiver_indices,
+                        size_t count) {
+    if (sender->list == NULL || count == 0) {
+        return NULL;
+    }
+    const scalar* coeff = sender->list->coeff;
+    size_t threshold = sender->list->coefficient_list_len;
+
+    scalar* shares = arena_alloc(sender->arena, sizeof(scalar) * count);
+    scalar* diff = OPENSSL_malloc(sizeof(scalar) * threshold);
+    if (!shares || !diff) {
+        OPENSSL_free(diff);
+        return NULL;
+    }
+
+    size_t i = 0;
+    while (i < count) {
+        if (receiver_indices[i] < 0) {
+            free_sec_shares(shares, count);
+            OPENSSL_free(diff);
             return NULL;
         }
 
-        BN_CTX_start(ctx);
-        BN_CTX_start(ctx2);
-
-        if (!BN_mod_exp(expo_product, b_index, sender->func->t[i].exponent, order, ctx) ||
-            !BN_mod_mul(multi_product, sender->func->t[i].coefficient, expo_product, order, ctx2)) {
-            BN_clear_free(expo_product);
-            BN_clear_free(multi_product);
-            BN_CTX_end(ctx);
-            BN_CTX_end(ctx2);
-            continue; // Skip this iteration on failure
+        // length of the run of consecutive indices starting here
+        size_t run = 1;
+        while (i + run < count &&
+               receiver_indices[i + run] == receiver_indices[i] + (int)run) {
+            run++;
         }
 
-        if (result == NULL) {
-            result = BN_new();
-            if (!result || !BN_copy(result, multi_product)) {
-                BN_clear_free(result);
-                BN_clear_free(expo_product);
-                BN_clear_free(multi_product);
-                BN_CTX_end(ctx);
-                BN_CTX_end(ctx2);
-                break; // Exit loop on failure
-            }
+        // differences pay off once the run is well past the t setup points
+        if (threshold > 1 && run >= 2 * threshold) {
+            poly_eval_run(coeff, threshold,
+                          participant_identifier(receiver_indices[i]), run,
+                          diff, &shares[i]);
         } else {
-            if (!BN_mod_add(result, result, multi_product, order, ctx2)) {
-                BN_clear_free(result);
-                BN_clear_free(expo_product);
-                BN_clear_free(multi_product);
-                BN_CTX_end(ctx);
-                BN_CTX_end(ctx2);
-                break; // Exit loop on failure
+            for (size_t j = 0; j < run; j++) {
+                poly_eval(coeff, threshold,
+                          participant_identifier(receiver_indices[i + j]),
+                          &shares[i + j]);
             }
         }
-
-        BN_CTX_end(ctx);
-        BN_CTX_end(ctx2);
-        BN_clear_free(expo_product);
-        BN_clear_free(multi_product);
+        i += run;
     }
 
-    BN_CTX_free(ctx);
-    BN_CTX_free(ctx2);
-    BN_clear_free(b_index);
-
-    return result;
+    OPENSSL_cleanse(diff, sizeof(scalar) * threshold);
+    OPENSSL_free(diff);
+    return shares;
 }
 
-
-void free_poly(participant* p) {
-    if (!p || !p->func) return; // Check if participant or polynomial is NULL
-
-    // Free each term's resources
-    for (int i = 0; i < p->func->n; i++) {
-        if (p->func->t[i].coefficient) {
-            BN_clear_free(p->func->t[i].coefficient);
-            p->func->t[i].coefficient = NULL; // Prevent double-free
-        }
-        if (p->func->t[i].exponent) {
-            BN_clear_free(p->func->t[i].exponent);
-            p->func->t[i].exponent = NULL; // Prevent double-free
-        }
-    }
-
-    // Free the terms array if allocated
-    if (p->func->t) {
-        OPENSSL_free(p->func->t); // Use OPENSSL_free to match OpenSSL_malloc
-        p->func->t = NULL;        // Nullify pointer to prevent misuse
-    }
-
-    // Free the polynomial structure
-    OPENSSL_free(p->func); // Use OPENSSL_free for OpenSSL-allocated memory
-    p->func = NULL;        // Nullify pointer to prevent misuse
+void free_sec_shares(scalar* shares, size_t count) {
+    if (shares == NULL) return;
+    OPENSSL_cleanse(shares, sizeof(scalar) * count);
 }
 
 
-rcvd_sec_shares* create_node_share(BIGNUM* sec_share) {
-    rcvd_sec_shares* newNode = (rcvd_sec_shares*)OPENSSL_malloc(sizeof(rcvd_sec_shares));
-    if (!newNode) return NULL; // Allocation failed
-
-    newNode->rcvd_share = BN_new();
-    if (!newNode->rcvd_share) {
-        OPENSSL_free(newNode);
-        return NULL; // Allocation failed
-    }
-
-    if (!BN_copy(newNode->rcvd_share, sec_share)) {
-        BN_clear_free(newNode->rcvd_share);
-        OPENSSL_free(newNode);
-        return NULL; // Copy failed
-    }
-
-    newNode->next = NULL;
-    return newNode;
+// Wipes the shares once summed; the slots go with the arena
+void free_rcvd_sec_shares(participant* p) {
+  if (p->rcvd_sec_shares != NULL) {
+    OPENSSL_cleanse(p->rcvd_sec_shares, sizeof(scalar) * p->participants);
+  }
+  presence_clear(&p->sec_shares_in);
 }
 
+// One share per sender: a second one is refused
+bool insert_share(participant* p, int sender_index, const scalar* sec_share) {
+  if (!init_rcvd_slots(p) || !valid_sender(p, sender_index) ||
+      !presence_add(&p->sec_shares_in, sender_index)) {
+    return false;
+  }
+  p->rcvd_sec_shares[sender_index] = *sec_share;
+  return true;
+}
 
-void free_rcvd_sec_shares(rcvd_sec_shares* head) {
-    rcvd_sec_shares* curr = head;
-    while (curr != NULL) {
-        rcvd_sec_shares* next = curr->next;
-
-        // Safely free rcvd_share
-        if (curr->rcvd_share) {
-            BN_clear_free(curr->rcvd_share);
-            curr->rcvd_share = NULL; // Prevent accidental reuse
-        }
+/* powers[k] = x ^ k for 0 ≤ k < len, one multiplication each, where x is
+ * the identifier of index */
+static void index_powers(int index, scalar* powers, size_t len) {
+  scalar b_x;
+  scalar_set_word(&b_x, participant_identifier(index));
+  scalar_one(&powers[0]);
+  for (size_t k = 1; k < len; k++) {
+    scalar_mul(&powers[k], &powers[k - 1], &b_x);
+  }
+}
 
-        // Free the current node
-        OPENSSL_free(curr);
-        curr = next;
+/*
+# G ^ f_j(i) ≟ ∏ 𝜙_j_k ^ (i ^ k mod G)  : 0 ≤ k ≤ t - 1
+*/
+static bool verify_dealer_share(const uint8_t* commit, size_t threshold,
+                                int receiver_index, const scalar* sec_share,
+                                frost_ctx* ctx) {
+  EC_POINT* res_G_over_fj = group_point_new();
+  EC_POINT* res_commits = group_point_new();
+  scalar* powers = OPENSSL_malloc(sizeof(scalar) * threshold);
+  const uint8_t** points = OPENSSL_malloc(sizeof(uint8_t*) * threshold);
+  bool verified = res_G_over_fj && res_commits && powers && points &&
+                  group_base_mul(res_G_over_fj, sec_share, ctx);
+
+  if (verified) {
+    index_powers(receiver_index, powers, threshold);
+    for (size_t k = 0; k < threshold; k++) {
+      points[k] = commit + k * COMMIT_POINT_BYTES;
     }
-}
+  }
 
-void insert_node_share(participant* p, BIGNUM* sec_share) {
-  rcvd_sec_shares* newNode = create_node_share(sec_share);
+  verified = verified &&
+             msm_encoded(res_commits, points, COMMIT_POINT_BYTES, powers,
+                         threshold, ctx) &&
+             EC_POINT_cmp(ctx->group, res_G_over_fj, res_commits, ctx->bn) == 0;
 
-  newNode->next = p->rcvd_sec_share_head;
-  p->rcvd_sec_share_head = newNode;
+  EC_POINT_free(res_G_over_fj);
+  EC_POINT_free(res_commits);
+  OPENSSL_free(powers);
+  OPENSSL_free(points);
+  return verified;
 }
 
 bool accept_sec_share(participant* receiver, int sender_index,
-                      BIGNUM* sec_share) {
-  int threshold = receiver->threshold;
-
-  if (receiver->rcvd_sec_share_head == NULL) {
-    receiver->rcvd_sec_share_head = create_node_share(sec_share);
-  } else {
-    insert_node_share(receiver, sec_share);
+                      const scalar* sec_share, frost_ctx* ctx) {
+  if (!insert_share(receiver, sender_index, sec_share)) {
+    return false;
   }
   /*
   # 2. Every participant Pi verifies the share they received from each other
@@ -422,62 +344,16 @@ bool accept_sec_share(participant* receiver, int sender_index,
 
   // TODO:
   if (sender_index == receiver->index) {
-    BN_clear_free(sec_share);
     return true;
   }
 
-  pub_commit_packet* sender_pub_commit =
-      search_node_commit(receiver->rcvd_commit_head, sender_index);
-
-  BN_CTX* ctx = BN_CTX_new();
-  BN_CTX* ctx2 = BN_CTX_new();
-  BN_CTX* ctx3 = BN_CTX_new();
-  BN_CTX* ctx4 = BN_CTX_new();
-  BN_CTX* ctx5 = BN_CTX_new();
-  BIGNUM* b_index = BN_new();
-  BIGNUM* res_G_over_fj = BN_new();
-  BIGNUM* res_commits = NULL;
-  BN_set_word(b_index, receiver->index);
-
-  BN_mod_mul(res_G_over_fj, b_generator, sec_share, order, ctx);
-
-  for (int k = 0; k < threshold; k++) {
-    BN_CTX_start(ctx2);
-    BN_CTX_start(ctx3);
-    BN_CTX_start(ctx4);
-    BIGNUM* b_k = BN_new();
-    BIGNUM* res_power = BN_new();
-    BIGNUM* commit_powered = BN_new();
-    BN_set_word(b_k, k);
-
-    BN_mod_exp(res_power, b_index, b_k, order, ctx2);
-    BN_mod_mul(commit_powered, sender_pub_commit->commit[k], res_power, order,
-               ctx3);
-    if (res_commits == NULL) {
-      res_commits = BN_new();
-      BN_copy(res_commits, commit_powered);
-    } else {
-      BN_mod_add(res_commits, res_commits, commit_powered, order, ctx4);
-    }
-    BN_clear_free(b_k);
-    BN_clear_free(res_power);
-    BN_clear_free(commit_powered);
-    BN_CTX_end(ctx2);
-    BN_CTX_end(ctx3);
-    BN_CTX_end(ctx4);
-  }
+  const uint8_t* sender_pub_commit = rcvd_commit(receiver, sender_index);
 
-  if (!BN_cmp(res_G_over_fj, res_commits)) {
-    BN_clear_free(b_index);
-    BN_clear_free(res_G_over_fj);
-    BN_clear_free(res_commits);
-    BN_clear_free(sec_share);
-    BN_CTX_free(ctx);
-    BN_CTX_free(ctx2);
-    BN_CTX_free(ctx3);
-    BN_CTX_free(ctx4);
-    BN_CTX_free(ctx5);
+  bool verified = sender_pub_commit &&
+                  verify_dealer_share(sender_pub_commit, receiver->threshold,
+                                      receiver->index, sec_share, ctx);
 
+  if (verified) {
     return true;
   } else {
     printf("\nVerification of public commitments failed!\n");
@@ -485,66 +361,159 @@ bool accept_sec_share(participant* receiver, int sender_index,
   }
 }
 
-bool gen_sec_share(participant* p, rcvd_sec_shares* head) {
-  BIGNUM* sum = BN_new();
-  BN_CTX* ctx = BN_CTX_new();
-  BN_zero(sum);
-  rcvd_sec_shares* current = head;
-
-  while (current != NULL) {
-    BN_CTX_start(ctx);
-    BN_mod_add(sum, sum, current->rcvd_share, order, ctx);
-    BN_CTX_end(ctx);
-    current = current->next;
+bool store_sec_share(participant* receiver, int sender_index,
+                     const scalar* sec_share) {
+  return insert_share(receiver, sender_index, sec_share);
+}
+
+/*
+# Batch form of the Feldman check over every dealer j with random ρ_j:
+# G ^ (∑ ρ_j * f_j(i)) ≟ ∏_j ∏_k 𝜙_j_k ^ (ρ_j * i ^ k)
+# A cheating dealer survives only if it guesses its ρ_j, so one MSM over all
+# n·t commitments replaces n separate checks.
+*/
+static bool verify_sec_shares_combined(participant* receiver, size_t dealers,
+                                       frost_ctx* ctx) {
+  size_t threshold = receiver->threshold;
+  size_t terms = dealers * threshold;
+  const uint8_t** points = OPENSSL_malloc(sizeof(uint8_t*) * terms);
+  scalar* weights = OPENSSL_malloc(sizeof(scalar) * terms);
+  scalar* powers = OPENSSL_malloc(sizeof(scalar) * threshold);
+  EC_POINT* lhs = group_point_new();
+  EC_POINT* rhs = group_point_new();
+  bool ok = points && weights && powers && lhs && rhs;
+
+  scalar combined, rho, weighted;
+  scalar_zero(&combined);
+  if (ok) {
+    index_powers(receiver->index, powers, threshold);
   }
 
-  BN_copy(p->secret_share, sum);
-  BN_free(sum);
-  BN_CTX_free(ctx);
-  return true;
+  size_t next = 0;
+  const presence_map* in = &receiver->sec_shares_in;
+  for (size_t j = presence_next(in, 0); ok && j < in->size;
+       j = presence_next(in, j + 1)) {
+    if ((int)j == receiver->index) continue;
+
+    const uint8_t* commit = rcvd_commit(receiver, (int)j);
+    ok = commit != NULL && generate_rand(ctx, &rho);
+    for (size_t k = 0; ok && k < threshold; k++) {
+      points[next] = commit + k * COMMIT_POINT_BYTES;
+      scalar_mul(&weights[next], &rho, &powers[k]);
+      next++;
+    }
+    scalar_mul(&weighted, &rho, &receiver->rcvd_sec_shares[j]);
+    scalar_add(&combined, &combined, &weighted);
+  }
+
+  ok = ok && next == terms && group_base_mul(lhs, &combined, ctx) &&
+       msm_encoded(rhs, points, COMMIT_POINT_BYTES, weights, terms, ctx) &&
+       EC_POINT_cmp(ctx->group, lhs, rhs, ctx->bn) == 0;
+
+  scalar_cleanse(&combined);
+  scalar_cleanse(&weighted);
+  OPENSSL_free(points);
+  OPENSSL_free(weights);
+  OPENSSL_free(powers);
+  EC_POINT_free(lhs);
+  EC_POINT_free(rhs);
+  return ok;
 }
 
-bool gen_pub_key(participant* p, rcvd_pub_commits* head, BIGNUM* self_commit) {
-  BIGNUM* product = BN_new();
-  BN_CTX* ctx = BN_CTX_new();
-  BN_copy(product, self_commit);
+bool verify_sec_shares(participant* receiver, int* blamed,
+                       size_t* blamed_count, frost_ctx* ctx) {
+  *blamed_count = 0;
+
+  /* s_i must sum the share of every dealer whose 𝜙_j_0 goes into Y: one
+   * withheld share leaves the keys inconsistent, so its dealer is blamed */
+  const presence_map* in = &receiver->sec_shares_in;
+  if (in->count != (size_t)receiver->participants) {
+    for (int j = 0; j < receiver->participants; j++) {
+      if (!presence_test(in, j)) {
+        blamed[(*blamed_count)++] = j;
+      }
+    }
+    return false;
+  }
+  size_t dealers = in->count - 1;
+  if (dealers == 0) {
+    return true;
+  }
 
-  while (head != NULL) {
-    BN_CTX_start(ctx);
-    BN_add(product, product, head->rcvd_packet->commit[0]);
-    BN_CTX_end(ctx);
-    head = head->next;
+  bool verified = verify_sec_shares_combined(receiver, dealers, ctx);
+
+  // the combined check failed: check dealer by dealer to name the cheaters
+  if (!verified) {
+    for (size_t j = presence_next(in, 0); j < in->size;
+         j = presence_next(in, j + 1)) {
+      if ((int)j == receiver->index) continue;
+
+      const uint8_t* commit = rcvd_commit(receiver, (int)j);
+      if (commit == NULL ||
+          !verify_dealer_share(commit, receiver->threshold,
+                               receiver->index, &receiver->rcvd_sec_shares[j],
+                               ctx)) {
+        blamed[(*blamed_count)++] = (int)j;
+      }
+    }
   }
 
-  BN_copy(p->public_key, product);
-  BN_free(product);
-  BN_CTX_free(ctx);
+  return verified;
+}
+
+bool gen_sec_share(participant* p) {
+  scalar sum;
+  scalar_zero(&sum);
+  const presence_map* in = &p->sec_shares_in;
 
+  for (size_t j = presence_next(in, 0); j < in->size;
+       j = presence_next(in, j + 1)) {
+    scalar_add(&sum, &sum, &p->rcvd_sec_shares[j]);
+  }
+
+  p->secret_share = sum;
+  scalar_cleanse(&sum);
   return true;
 }
 
-void gen_keys(participant* p) {
+/* Y = ∑ 𝜙_j_0 over every published dealer, own row included: column 0 of
+ * the store's matrix */
+bool gen_pub_key(participant* p, frost_ctx* ctx) {
+  const commit_store* store = p->commits;
+  EC_POINT* phi = group_point_new();
+  bool ok = store != NULL && phi != NULL &&
+            EC_POINT_set_to_infinity(ctx->group, p->public_key);
+
+  for (size_t j = 0; ok && j < store->rows; j++) {
+    if (!presence_test(&store->published, j)) continue;
+    ok = commit_point_decode(phi, commit_store_point(store, j, 0), ctx) &&
+         EC_POINT_add(ctx->group, p->public_key, p->public_key, phi, ctx->bn);
+  }
+
+  EC_POINT_free(phi);
+  return ok;
+}
+
+void gen_keys(participant* p, frost_ctx* ctx) {
     __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Participant[%d] generating keys...", p->index);
 
-    p->secret_share = BN_new();
-    p->verify_share = BN_new();
-    p->public_key = BN_new();
+    p->verify_share = group_point_new();
+    p->public_key = group_point_new();
     bool success = true;
-    BN_CTX* ctx = BN_CTX_new();
 
-    if (!gen_sec_share(p, p->rcvd_sec_share_head)) {
+    if (!gen_sec_share(p)) {
         success = false;
         __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to generate secret share for participant[%d]", p->index);
         abort();
     }
 
-    if (!BN_mul(p->verify_share, b_generator, p->secret_share, ctx)) {
+    if (!group_base_mul(p->verify_share, &p->secret_share, ctx)) {
         success = false;
         __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to generate verification share for participant[%d]", p->index);
         abort();
     }
 
-    if (!gen_pub_key(p, p->rcvd_commit_head, p->pub_commit->commit[0])) {
+    if (!gen_pub_key(p, ctx)) {
         success = false;
         __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to generate public key for participant[%d]", p->index);
         abort();
@@ -554,11 +523,12 @@ void gen_keys(participant* p) {
         __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Participant[%d] successfully generated the keys", p->index);
     }
 
-    // Free used memory for every participant
-    BN_CTX_free(ctx);
+    // Wipe the secrets now; the DKG objects themselves go with the arena
     free_coeff_list(p);
-    free_pub_commit(p->pub_commit);
-    free_poly(p);
-    free_rcvd_pub_commits(p->rcvd_commit_head);
-    free_rcvd_sec_shares(p->rcvd_sec_share_head);
+    free_rcvd_sec_shares(p);
+    p->pub_commit = NULL;
+    commit_store_release(p->commits);
+    p->commits = NULL;
+    p->rcvd_sec_shares = NULL;
+    p->sec_shares_in = (presence_map){0};
 }
@@ -0,0 +1,353 @@
+#include "../headers/sha256_multi.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+static const uint32_t SHA256_IV[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                      0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                      0x1f83d9ab, 0x5be0cd19};
+
+void sha256_lane_init(sha256_lane* lane, uint8_t* out) {
+  memset(lane, 0, sizeof(*lane));
+  memcpy(lane->h, SHA256_IV, sizeof(lane->h));
+  lane->out = out;
+}
+
+void sha256_lane_absorb(sha256_lane* lane, const uint8_t* blocks,
+                        size_t num_blocks) {
+  SHA256_TransformBlocks(lane->h, blocks, num_blocks);
+  lane->prefix_len += (uint64_t)num_blocks * SHA256_CBLOCK;
+}
+
+bool sha256_lane_add(sha256_lane* lane, const void* data, size_t len) {
+  if (lane->parts == SHA256_LANE_PARTS) {
+    return false;
+  }
+  lane->part[lane->parts] = data;
+  lane->part_len[lane->parts++] = len;
+  return true;
+}
+
+static void write_digest(uint8_t* out, const uint32_t h[8]) {
+  for (int k = 0; k < 8; k++) {
+    out[4 * k] = (uint8_t)(h[k] >> 24);
+    out[4 * k + 1] = (uint8_t)(h[k] >> 16);
+    out[4 * k + 2] = (uint8_t)(h[k] >> 8);
+    out[4 * k + 3] = (uint8_t)h[k];
+  }
+}
+
+/* Walks the padded message of a lane block by block. Blocks inside one part
+ * are returned in place; blocks that straddle parts and the final padded
+ * blocks are staged in tail. */
+typedef struct {
+  const sha256_lane* lane;
+  int part;
+  size_t off;
+  uint64_t left;  // message bytes not returned yet
+  uint64_t total;
+  uint8_t tail[2 * SHA256_CBLOCK];
+  size_t tail_blocks;  // final blocks staged, 0 before the end
+  size_t tail_next;
+} lane_cursor;
+
+static void cursor_init(lane_cursor* c, const sha256_lane* lane) {
+  c->lane = lane;
+  c->part = 0;
+  c->off = 0;
+  c->total = 0;
+  for (int i = 0; i < lane->parts; i++) {
+    c->total += lane->part_len[i];
+  }
+  c->left = c->total;
+  c->tail_blocks = 0;
+  c->tail_next = 0;
+}
+
+static void cursor_copy(lane_cursor* c, uint8_t* dst, size_t n) {
+  while (n > 0) {
+    size_t avail = c->lane->part_len[c->part] - c->off;
+    if (avail == 0) {
+      c->part++;
+      c->off = 0;
+      continue;
+    }
+    size_t take = avail < n ? avail : n;
+    memcpy(dst, c->lane->part[c->part] + c->off, take);
+    c->off += take;
+    c->left -= take;
+    dst += take;
+    n -= take;
+  }
+}
+
+/* Next block, with *run set to the number of contiguous blocks (at most
+ * max_run) that start there; NULL once the padding has been returned */
+static const uint8_t* cursor_next(lane_cursor* c, size_t max_run,
+                                  size_t* run) {
+  *run = 1;
+  if (c->tail_blocks > 0) {
+    return c->tail_next < c->tail_blocks
+               ? c->tail + SHA256_CBLOCK * c->tail_next++
+               : NULL;
+  }
+
+  if (c->left >= SHA256_CBLOCK) {
+    while (c->off == c->lane->part_len[c->part]) {
+      c->part++;
+      c->off = 0;
+    }
+    size_t avail = c->lane->part_len[c->part] - c->off;
+    if (avail >= SHA256_CBLOCK) {
+      size_t blocks = avail / SHA256_CBLOCK;
+      *run = blocks < max_run ? blocks : max_run;
+      const uint8_t* p = c->lane->part[c->part] + c->off;
+      c->off += *run * SHA256_CBLOCK;
+      c->left -= *run * SHA256_CBLOCK;
+      return p;
+    }
+    cursor_copy(c, c->tail, SHA256_CBLOCK);
+    return c->tail;
+  }
+
+  // the last bytes, 0x80, zeros and the length in bits: one or two blocks
+  size_t rem = (size_t)c->left;
+  memset(c->tail, 0, sizeof(c->tail));
+  cursor_copy(c, c->tail, rem);
+  c->tail[rem] = 0x80;
+  c->tail_blocks = rem + 9 <= SHA256_CBLOCK ? 1 : 2;
+  uint64_t bits = (c->lane->prefix_len + c->total) * 8;
+  uint8_t* len_at = c->tail + SHA256_CBLOCK * c->tail_blocks - 8;
+  for (int i = 0; i < 8; i++) {
+    len_at[i] = (uint8_t)(bits >> (56 - 8 * i));
+  }
+  c->tail_next = 1;
+  return c->tail;
+}
+
+// Finishes one lane from chaining value h, the cursor already under way
+static void finish_lane(lane_cursor* c, uint32_t h[8]) {
+  const uint8_t* block;
+  size_t run;
+  while ((block = cursor_next(c, SIZE_MAX, &run)) != NULL) {
+    SHA256_TransformBlocks(h, block, run);
+  }
+  write_digest(c->lane->out, h);
+}
+
+static void lanes_scalar(sha256_lane* lanes, size_t count) {
+  lane_cursor c;
+  for (size_t i = 0; i < count; i++) {
+    uint32_t h[8];
+    memcpy(h, lanes[i].h, sizeof(h));
+    cursor_init(&c, &lanes[i]);
+    finish_lane(&c, h);
+  }
+}
+
+#if defined(__x86_64__)
+#define AVX2 __attribute__((target("avx2")))
+#define LANES 8
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static const uint8_t ZERO_BLOCK[SHA256_CBLOCK];
+
+#define ROTR(x, n) \
+  _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+#define XOR3(a, b, c) _mm256_xor_si256(_mm256_xor_si256(a, b), c)
+
+/* Words off/4 .. off/4 + 7 of the eight blocks, one vector per word */
+static AVX2 void load_words(__m256i w[8], const uint8_t* const blocks[LANES],
+                            size_t off) {
+  const __m256i bswap = _mm256_setr_epi8(
+      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6,
+      5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  __m256i r[LANES], t[LANES], u[LANES];
+  for (int i = 0; i < LANES; i++) {
+    r[i] = _mm256_loadu_si256((const __m256i*)(blocks[i] + off));
+  }
+
+  // 8x8 transpose of 32-bit words
+  for (int i = 0; i < LANES; i += 2) {
+    t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+    t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+  }
+  for (int i = 0; i < LANES; i += 4) {
+    u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+    u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+    u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+    u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+  }
+  for (int i = 0; i < 4; i++) {
+    w[i] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u[i], u[i + 4], 0x20),
+                               bswap);
+    w[i + 4] = _mm256_shuffle_epi8(
+        _mm256_permute2x128_si256(u[i], u[i + 4], 0x31), bswap);
+  }
+}
+
+// One block for each of the eight lanes; lanes outside active keep s
+static AVX2 void compress8(__m256i s[8], const uint8_t* const blocks[LANES],
+                           __m256i active) {
+  __m256i w[16];
+  load_words(w, blocks, 0);
+  load_words(w + 8, blocks, 32);
+
+  __m256i a = s[0], b = s[1], c = s[2], d = s[3];
+  __m256i e = s[4], f = s[5], g = s[6], h = s[7];
+  for (int t = 0; t < 64; t++) {
+    __m256i wt;
+    if (t < 16) {
+      wt = w[t];
+    } else {
+      __m256i w15 = w[(t - 15) & 15], w2 = w[(t - 2) & 15];
+      __m256i s0 = XOR3(ROTR(w15, 7), ROTR(w15, 18), _mm256_srli_epi32(w15, 3));
+      __m256i s1 = XOR3(ROTR(w2, 17), ROTR(w2, 19), _mm256_srli_epi32(w2, 10));
+      wt = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], s0),
+                            _mm256_add_epi32(w[(t - 7) & 15], s1));
+      w[t & 15] = wt;
+    }
+
+    __m256i S1 = XOR3(ROTR(e, 6), ROTR(e, 11), ROTR(e, 25));
+    __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f),
+                                  _mm256_andnot_si256(e, g));
+    __m256i t1 = _mm256_add_epi32(
+        _mm256_add_epi32(_mm256_add_epi32(h, S1), ch),
+        _mm256_add_epi32(_mm256_set1_epi32((int)K[t]), wt));
+    __m256i S0 = XOR3(ROTR(a, 2), ROTR(a, 13), ROTR(a, 22));
+    __m256i maj = XOR3(_mm256_and_si256(a, b), _mm256_and_si256(a, c),
+                       _mm256_and_si256(b, c));
+    __m256i t2 = _mm256_add_epi32(S0, maj);
+
+    h = g;
+    g = f;
+    f = e;
+    e = _mm256_add_epi32(d, t1);
+    d = c;
+    c = b;
+    b = a;
+    a = _mm256_add_epi32(t1, t2);
+  }
+
+  __m256i out[8] = {a, b, c, d, e, f, g, h};
+  for (int k = 0; k < 8; k++) {
+    s[k] = _mm256_blendv_epi8(s[k], _mm256_add_epi32(s[k], out[k]), active);
+  }
+}
+
+static AVX2 void lanes_avx2(sha256_lane* lanes, size_t count) {
+  for (size_t first = 0; first < count; first += LANES) {
+    size_t n = count - first < LANES ? count - first : LANES;
+    lane_cursor cursors[LANES];
+    uint32_t words[LANES] __attribute__((aligned(32)));
+    __m256i s[8];
+    bool live[LANES] = {false}, finished[LANES] = {false};
+
+    for (size_t i = 0; i < n; i++) {
+      cursor_init(&cursors[i], &lanes[first + i]);
+      live[i] = true;
+    }
+    for (int k = 0; k < 8; k++) {
+      for (size_t i = 0; i < LANES; i++) {
+        words[i] = i < n ? lanes[first + i].h[k] : 0;
+      }
+      s[k] = _mm256_load_si256((const __m256i*)words);
+    }
+
+    for (;;) {
+      const uint8_t* blocks[LANES];
+      uint32_t mask[LANES] __attribute__((aligned(32)));
+      size_t active = 0, last = 0, run;
+      for (size_t i = 0; i < LANES; i++) {
+        const uint8_t* block =
+            live[i] ? cursor_next(&cursors[i], 1, &run) : NULL;
+        live[i] = block != NULL;
+        blocks[i] = live[i] ? block : ZERO_BLOCK;
+        mask[i] = live[i] ? 0xffffffff : 0;
+        if (live[i]) {
+          active++;
+          last = i;
+        }
+      }
+      if (active == 0) {
+        break;
+      }
+
+      if (active == 1) {
+        // a single long lane left: the scalar path is faster than 1/8 of AVX2
+        uint32_t h[8];
+        for (int k = 0; k < 8; k++) {
+          _mm256_store_si256((__m256i*)words, s[k]);
+          h[k] = words[last];
+        }
+        SHA256_TransformBlocks(h, blocks[last], 1);
+        finish_lane(&cursors[last], h);
+        live[last] = false;
+        finished[last] = true;
+        continue;
+      }
+      compress8(s, blocks, _mm256_load_si256((const __m256i*)mask));
+    }
+
+    for (size_t i = 0; i < n; i++) {
+      if (finished[i]) {
+        continue;  // digest written on the scalar path
+      }
+      uint32_t h[8];
+      for (int k = 0; k < 8; k++) {
+        _mm256_store_si256((__m256i*)words, s[k]);
+        h[k] = words[i];
+      }
+      write_digest(lanes[first + i].out, h);
+    }
+  }
+}
+
+/* AVX2 pays off only without the SHA extensions, which make the one-lane
+ * path about as fast as eight AVX2 lanes */
+static bool avx2_preferred() {
+  unsigned a, b, c, d;
+  bool sha_ext = __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & (1u << 29));
+  return __builtin_cpu_supports("avx2") && !sha_ext;
+}
+#endif
+
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+static void (*lanes_kernel)(sha256_lane*, size_t) = lanes_scalar;
+static int kernel_width = 1;
+
+static void pick_kernel() {
+#if defined(__x86_64__)
+  if (avx2_preferred()) {
+    lanes_kernel = lanes_avx2;
+    kernel_width = LANES;
+  }
+#endif
+}
+
+void sha256_lanes(sha256_lane* lanes, size_t count) {
+  pthread_once(&kernel_once, pick_kernel);
+  lanes_kernel(lanes, count);
+}
+
+int sha256_lanes_width() {
+  pthread_once(&kernel_once, pick_kernel);
+  return kernel_width;
+}
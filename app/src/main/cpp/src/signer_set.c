@@ -0,0 +1,51 @@
+#include "../headers/signer_set.h"
+
+bool signer_set_init(signer_set* set, session_arena* arena, const int* indices,
+                     size_t count, size_t participants) {
+  set->indices = arena_alloc(arena, sizeof(int) * count);
+  set->size = count;
+  if (set->indices == NULL ||
+      !presence_init(&set->members, arena, participants)) {
+    return false;
+  }
+
+  // the bitset rejects repeats; walking it in order sorts the indices
+  for (size_t i = 0; i < count; i++) {
+    if (indices[i] < 0 || !presence_add(&set->members, indices[i])) {
+      return false;
+    }
+  }
+  size_t next = 0;
+  const presence_map* in = &set->members;
+  for (size_t j = presence_next(in, 0); j < in->size;
+       j = presence_next(in, j + 1)) {
+    set->indices[next++] = (int)j;
+  }
+  return true;
+}
+
+bool signer_set_dup(signer_set* out, session_arena* arena,
+                    const signer_set* in) {
+  return signer_set_init(out, arena, in->indices, in->size,
+                         in->members.size);
+}
+
+bool signer_set_contains(const signer_set* set, int index) {
+  return index >= 0 && presence_test(&set->members, index);
+}
+
+int signer_set_position(const signer_set* set, int index) {
+  if (!signer_set_contains(set, index)) {
+    return -1;
+  }
+  size_t lo = 0, hi = set->size;
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (set->indices[mid] <= index) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return (int)lo;
+}
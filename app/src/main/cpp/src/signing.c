@@ -7,441 +7,843 @@
 #include "../boringssl/include/openssl/obj_mac.h"
 #include "../boringssl/include/openssl/sha.h"
 
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "../headers/arena.h"
+#include "../headers/context.h"
 #include "../headers/globals.h"
+#include "../headers/group.h"
+#include "../headers/lagrange.h"
+#include "../headers/message.h"
+#include "../headers/msm.h"
+#include "../headers/nonce.h"
+#include "../headers/prehash.h"
+#include "../headers/presence.h"
 #include "../headers/setup.h"
-#include "openssl/digest.h"
+#include "../headers/sha256_multi.h"
+#include "../headers/signer_set.h"
 
 /*Preprocess stage*/
-pub_share_packet* init_pub_share(participant* p) {
-  BN_CTX* ctx = BN_CTX_new();
-  BIGNUM* rand = generate_rand();
-  p->pub_share = malloc(sizeof(pub_share_packet));
-  p->pub_share->pub_share = BN_new();
-  p->pub_share->verify_share = BN_new();
-  p->pub_share->public_key = BN_new();
-  p->nonce = BN_new();
-  p->pub_share->sender_index = p->index;
 
-  BN_copy(p->pub_share->verify_share, p->verify_share);
-  BN_copy(p->pub_share->public_key, p->public_key);
-  BN_copy(p->nonce, rand);
-  BN_mul(p->pub_share->pub_share, b_generator, p->nonce, ctx);
-
-  BN_CTX_free(ctx);
-  BN_clear_free(rand);
+// Packet j announces pair ids[j] of p's nonce store
+static pub_share_packet* pub_shares_for(participant* p, const uint32_t* ids,
+                                        uint32_t first_id, size_t count,
+                                        frost_ctx* ctx) {
+  pub_share_packet* packets =
+      arena_alloc(p->arena, sizeof(pub_share_packet) * count);
+  bool ok = packets != NULL;
+  for (size_t j = 0; ok && j < count; j++) {
+    packets[j].sender_index = p->index;
+    packets[j].nonce_id = ids ? ids[j] : first_id + (uint32_t)j;
+    packets[j].pub_share = arena_point_new(p->arena);
+    packets[j].binding_share = arena_point_new(p->arena);
+    packets[j].verify_share = arena_point_dup(p->arena, p->verify_share);
+    packets[j].public_key = arena_point_dup(p->arena, p->public_key);
+    ok = packets[j].pub_share && packets[j].binding_share &&
+         packets[j].verify_share && packets[j].public_key &&
+         nonce_store_commitment(p->nonces, packets[j].nonce_id,
+                                packets[j].pub_share,
+                                packets[j].binding_share, ctx);
+  }
 
-  return p->pub_share;
+  return ok ? packets : NULL;
 }
 
-void free_pub_share(pub_share_packet* pub_share) {
-  BN_clear_free(pub_share->pub_share);
-  BN_clear_free(pub_share->verify_share);
-  BN_clear_free(pub_share->public_key);
-  free(pub_share);
+bool attach_nonce_store(participant* p, const char* path) {
+  if (p->nonces != NULL) {
+    return false;
+  }
+  p->nonces = nonce_store_open(path, NONCE_STORE_CAPACITY);
+  return p->nonces != NULL;
 }
 
-rcvd_pub_shares* create_node_pub_share(pub_share_packet* rcvd_packet) {
-  rcvd_pub_shares* newNode = malloc(sizeof(rcvd_pub_shares));
-  newNode->rcvd_packets = malloc(sizeof(pub_share_packet));
-  newNode->next = NULL;
-  newNode->rcvd_packets->verify_share = BN_new();
-  newNode->rcvd_packets->pub_share = BN_new();
-  newNode->rcvd_packets->public_key = BN_new();
-
-  newNode->rcvd_packets->sender_index = rcvd_packet->sender_index;
-  BN_copy(newNode->rcvd_packets->pub_share, rcvd_packet->pub_share);
-  BN_copy(newNode->rcvd_packets->verify_share, rcvd_packet->verify_share);
-  BN_copy(newNode->rcvd_packets->public_key, rcvd_packet->public_key);
+pub_share_packet* init_pub_shares(participant* p, size_t count,
+                                  frost_ctx* ctx) {
+  if (p->nonces == NULL) {
+    p->nonces = nonce_store_new(count > NONCE_STORE_CAPACITY
+                                    ? count
+                                    : NONCE_STORE_CAPACITY);
+  }
 
-  return newNode;
+  // D_j = G ^ d_j and E_j = G ^ e_j, computed and kept by the store
+  uint32_t first_id;
+  bool ok = p->nonces &&
+            nonce_store_generate(p->nonces, count, &first_id, ctx);
+  if (!ok) {
+    printf("\nNo room for %zu more nonces of participant %d!\n", count,
+           p->index);
+    return NULL;
+  }
+  return pub_shares_for(p, NULL, first_id, count, ctx);
 }
 
-void free_node_pub_share(rcvd_pub_shares* node) {
-  if (node == NULL) {
-    return;
+pub_share_packet* republish_pub_shares(participant* p, size_t* count,
+                                       frost_ctx* ctx) {
+  *count = 0;
+  // pairs another process generated into the same file count too
+  size_t generated = p->nonces ? nonce_store_published(p->nonces) : 0;
+  if (generated == 0) {
+    return NULL;
   }
 
-  free_node_pub_share(node->next);  // free memory for remaining nodes
+  uint32_t* ids = malloc(sizeof(uint32_t) * generated);
+  if (ids == NULL) {
+    return NULL;
+  }
+  for (size_t j = 0; j < generated; j++) {
+    if (!nonce_store_is_used(p->nonces, (uint32_t)j)) {
+      ids[(*count)++] = (uint32_t)j;
+    }
+  }
 
-  if (node->rcvd_packets != NULL) {
-    BN_clear_free(node->rcvd_packets->verify_share);
-    BN_clear_free(node->rcvd_packets->pub_share);
-    BN_clear_free(node->rcvd_packets->public_key);
-    node->rcvd_packets->sender_index = 0;
-    free(node->rcvd_packets);
+  pub_share_packet* packets =
+      *count > 0 ? pub_shares_for(p, ids, 0, *count, ctx) : NULL;
+  if (packets == NULL) {
+    *count = 0;
   }
+  free(ids);
+  return packets;
+}
 
-  free(node);
+pub_share_packet* init_pub_share(participant* p, frost_ctx* ctx) {
+  return init_pub_shares(p, 1, ctx);
 }
 
-pub_share_packet* search_node_pub_share(rcvd_pub_shares* head,
-                                        int sender_index) {
-  rcvd_pub_shares* current = head;  // Initialize current
-  while (current != NULL) {
-    if (current->rcvd_packets->sender_index == sender_index)
-      return current->rcvd_packets;
-    current = current->next;
-  }
-  printf("Sender's public share were not found!");
+static bool valid_sender(const aggregator* a, int sender_index) {
+  return sender_index >= 0 && sender_index < a->participants;
 }
 
-void insert_node_pub_share(aggregator* agg, pub_share_packet* rcvd_packet) {
-  rcvd_pub_shares* newNode = create_node_pub_share(rcvd_packet);
-  newNode->next = agg->rcvd_pub_share_head;
-  agg->rcvd_pub_share_head = newNode;
+// The pool queue of sender, NULL for an index outside the group
+static pub_share_queue* pool_queue(aggregator* a, int sender_index) {
+  if (!valid_sender(a, sender_index)) {
+    return NULL;
+  }
+  if (a->pool == NULL) {
+    a->pool = arena_alloc(a->arena, sizeof(pub_share_queue) * a->participants);
+  }
+  return a->pool ? &a->pool[sender_index] : NULL;
 }
 
-bool accept_pub_share(aggregator* receiver, pub_share_packet* packet) {
-  if (receiver->rcvd_pub_share_head == NULL) {
-    receiver->rcvd_pub_share_head = create_node_pub_share(packet);
-    return true;
-  } else {
-    insert_node_pub_share(receiver, packet);
+// Room at the back of the queue for one more packet
+static bool queue_reserve(session_arena* arena, pub_share_queue* queue) {
+  if (queue->count < queue->capacity) {
     return true;
   }
-  return false;
+  size_t unused = queue->count - queue->first;
+  size_t capacity = 2 * unused + 4;
+  pub_share_packet* packets =
+      arena_alloc(arena, sizeof(pub_share_packet) * capacity);
+  if (packets == NULL) {
+    return false;
+  }
+  if (unused > 0) {
+    memcpy(packets, queue->packets + queue->first,
+           sizeof(pub_share_packet) * unused);
+  }
+  queue->packets = packets;
+  queue->first = 0;
+  queue->count = unused;
+  queue->capacity = capacity;
+  return true;
 }
 
-bool search_pub_share(rcvd_pub_shares* head, int sender_index) {
-  rcvd_pub_shares* current = head;  // Initialize current
-  while (current != NULL) {
-    if (current->rcvd_packets->sender_index == sender_index) return true;
-    current = current->next;
+bool insert_pub_share(aggregator* agg, const pub_share_packet* rcvd_packet) {
+  pub_share_queue* queue = pool_queue(agg, rcvd_packet->sender_index);
+  if (queue == NULL || !queue_reserve(agg->arena, queue)) {
+    return false;
   }
-  printf("Sender's public share were not found!");
-  return false;
+
+  pub_share_packet* copy = &queue->packets[queue->count];
+  copy->sender_index = rcvd_packet->sender_index;
+  copy->nonce_id = rcvd_packet->nonce_id;
+  copy->pub_share = arena_point_dup(agg->arena, rcvd_packet->pub_share);
+  copy->binding_share =
+      arena_point_dup(agg->arena, rcvd_packet->binding_share);
+  copy->verify_share = arena_point_dup(agg->arena, rcvd_packet->verify_share);
+  copy->public_key = arena_point_dup(agg->arena, rcvd_packet->public_key);
+  if (!copy->pub_share || !copy->binding_share || !copy->verify_share ||
+      !copy->public_key) {
+    return false;
+  }
+
+  queue->count++;
+  return true;
 }
 
-void pub_shares_mul(aggregator* a) {
-  BIGNUM* res_R_pub_commit = BN_new();
-  BN_CTX* ctx = BN_CTX_new();
-  a->R_pub_commit = BN_new();
-  rcvd_pub_shares* current = a->rcvd_pub_share_head;
-  BN_zero(res_R_pub_commit);
+void free_pub_share_pool(aggregator* a) {
+  a->pool = NULL;
+}
+
+bool accept_pub_share(aggregator* receiver, pub_share_packet* packet) {
+  return insert_pub_share(receiver, packet);
+}
 
-  while (current != NULL) {
-    BN_CTX_start(ctx);
-    BN_mod_add(res_R_pub_commit, res_R_pub_commit,
-               current->rcvd_packets->pub_share, order, ctx);
-    BN_CTX_end(ctx);
-    current = current->next;
+bool search_pub_share(const aggregator* a, int sender_index) {
+  if (a->pool == NULL || !valid_sender(a, sender_index) ||
+      a->pool[sender_index].first == a->pool[sender_index].count) {
+    printf("Sender's public share were not found!");
+    return false;
+  }
+  return true;
+}
+
+/* Takes the oldest unused commitment of sender from the pool. Each
+ * commitment serves one session only. */
+static pub_share_packet* take_pub_share(aggregator* a, int sender_index) {
+  if (!search_pub_share(a, sender_index)) {
+    return NULL;
   }
+  pub_share_queue* queue = &a->pool[sender_index];
+  return &queue->packets[queue->first++];
+}
 
-  BN_copy(a->R_pub_commit, res_R_pub_commit);
+static void free_session(aggregator* a);
 
-  BN_clear_free(res_R_pub_commit);
-  BN_CTX_free(ctx);
+/* The objects of the current session: the aggregator's session arena if it
+ * has one, else its own arena */
+static session_arena* session_memory(const aggregator* a) {
+  return a->session != NULL ? a->session : a->arena;
 }
 
-bool R_pub_commit_compute(aggregator* a, participant* set, int set_size) {
+/* Tuple without the message: the set, the commitment list and λ. Takes one
+ * pooled commitment per signer into a->session_shares. */
+static tuple_packet* build_tuple_packet(aggregator* a, const int* set,
+                                        int set_size) {
+  if (a->threshold != set_size) {
+    printf("\nMismatch of threshold and included participants!\n");
+    abort();
+  }
+
   /*
- # 1. Aggregator computes the signing group’s public commitment ∏ D_ij
- # selected participants P_i broadcast tuple (m, R, S, D_ij ) to every one of
- them.
+ # 1. Aggregator picks an unused commitment (D_ij, E_ij) of every signer
+ # selected participants P_i receive tuple (m, R, S, {(i, D_ij, E_ij)}).
  #
  */
+  for (int i = 0; i < set_size; i++) {
+    if (!search_pub_share(a, set[i])) {
+      printf("Mismatch of signing participant and received shares!");
+      return NULL;
+    }
+  }
 
-  bool all_found = true;
-  rcvd_pub_shares* currect = a->rcvd_pub_share_head;
+  // the previous session's objects are done with: rewind for this one
+  if (a->session != NULL) {
+    free_session(a);
+    arena_reset(a->session);
+  }
+  session_arena* arena = session_memory(a);
+  tuple_packet* t = arena_alloc(arena, sizeof(tuple_packet));
+  if (t == NULL) {
+    return NULL;
+  }
+  if (!signer_set_init(&t->S, arena, set, set_size, a->participants)) {
+    printf("\nDuplicate index in the signing set!\n");
+    abort();
+  }
+  t->nonce_ids = arena_alloc(arena, sizeof(uint32_t) * set_size);
+  t->hiding = arena_alloc(arena, sizeof(EC_POINT*) * set_size);
+  t->binding = arena_alloc(arena, sizeof(EC_POINT*) * set_size);
+  t->lambda = arena_alloc(arena, sizeof(scalar) * set_size);
+  t->rho = arena_alloc(arena, sizeof(scalar) * set_size);
+  pub_share_packet** shares =
+      arena_alloc(arena, sizeof(pub_share_packet*) * set_size);
+  if (!t->nonce_ids || !t->hiding || !t->binding || !t->lambda || !t->rho ||
+      !shares) {
+    return NULL;
+  }
 
+  a->tuple = t;
+  a->session_shares = shares;
   for (int i = 0; i < set_size; i++) {
-    if (!search_pub_share(a->rcvd_pub_share_head, set[i].index)) {
-      all_found = false;
-      break;
-    }
+    pub_share_packet* share = take_pub_share(a, t->S.indices[i]);
+    a->session_shares[i] = share;
+    t->nonce_ids[i] = share->nonce_id;
+    t->hiding[i] = share->pub_share;
+    t->binding[i] = share->binding_share;
   }
 
-  if (all_found) {
-    pub_shares_mul(a);
-    return true;
-  } else {
-    printf("Mismatch of signing participant and received shares!");
-    return false;
+  // session memo: λ here, ρ, R and the challenge once the message is read
+  if (!lagrange_cache_get(t->S.indices, set_size, t->lambda)) {
+    printf("\nLagrange coefficients of the signing set failed!\n");
+    abort();
+  }
+
+  if (a->public_key == NULL) {
+    a->public_key = a->session_shares[0]->public_key;
   }
+  return a->tuple;
+}
+
+/* Drops the commitments the session consumed, the tuple and R; their memory
+ * goes with the arena */
+static void free_session(aggregator* a) {
+  a->session_shares = NULL;
+  a->tuple = NULL;
+  a->R_pub_commit = NULL;
 }
 
+static bool bind_session(aggregator* a, const message_source* m,
+                         signing_mode mode, frost_ctx* ctx);
+
 tuple_packet* init_tuple_packet(aggregator* a, char* m, size_t m_size,
-                                participant* set, int set_size) {
-  if (a->threshold != set_size) {
-    printf("\nMismatch of threshold and included participants!\n");
-    abort();
+                                const int* set, int set_size,
+                                frost_ctx* ctx) {
+  message_source src = message_from_buffer((const uint8_t*)m, m_size);
+  return init_tuple_packet_stream(a, &src, SIGNING_RAW, set, set_size, ctx);
+}
+
+tuple_packet* init_tuple_packet_stream(aggregator* a, const message_source* m,
+                                       signing_mode mode, const int* set,
+                                       int set_size, frost_ctx* ctx) {
+  if (build_tuple_packet(a, set, set_size) != NULL &&
+      !bind_session(a, m, mode, ctx)) {
+    printf("\nMessage could not be read twice or invalid commitment!\n");
+    free_session(a);
   }
 
-  if (R_pub_commit_compute(a, set, set_size)) {
-    a->tuple = malloc(sizeof(tuple_packet));
-    a->tuple->m = malloc(sizeof(char) * m_size);
-    a->tuple->S = malloc(sizeof(participant) * set_size);
-    a->tuple->R = BN_new();
+  return a->tuple;
+}
 
-    a->tuple->m_size = m_size;
-    BN_copy(a->tuple->R, a->R_pub_commit);
-    a->tuple->S_size = a->threshold;
+// The participant's objects of the current session, as session_memory
+static session_arena* participant_memory(const participant* p) {
+  return p->session != NULL ? p->session : p->arena;
+}
 
-    for (int i = 0; i < set_size; i++) {
-      a->tuple->S[i] = set[i];
-    }
-    for (int i = 0; i < m_size; i++) {
-      a->tuple->m[i] = m[i];
+bool accept_tuple(participant* receiver, tuple_packet* packet) {
+  if (receiver->session != NULL) {
+    // the previous tuple goes: a participant signs one session at a time
+    receiver->rcvd_tuple = NULL;
+    arena_reset(receiver->session);
+  }
+  session_arena* arena = participant_memory(receiver);
+  size_t n = packet->S.size;
+  tuple_packet* t = arena_alloc(arena, sizeof(tuple_packet));
+  if (t == NULL || !signer_set_dup(&t->S, arena, &packet->S)) {
+    return false;
+  }
+
+  t->m_size = packet->m_size;
+
+  t->nonce_ids = arena_dup(arena, packet->nonce_ids, sizeof(uint32_t) * n);
+  t->hiding = arena_alloc(arena, sizeof(EC_POINT*) * n);
+  t->binding = arena_alloc(arena, sizeof(EC_POINT*) * n);
+  for (size_t i = 0; t->hiding && t->binding && i < n; i++) {
+    t->hiding[i] = arena_point_dup(arena, packet->hiding[i]);
+    t->binding[i] = arena_point_dup(arena, packet->binding[i]);
+  }
+
+  // only the commitment list is taken: init_sig_share derives the rest
+  t->R = NULL;
+  scalar_zero(&t->challenge);
+  t->lambda = NULL;
+  t->rho = arena_alloc(arena, sizeof(scalar) * n);
+  if (!t->nonce_ids || !t->hiding || !t->binding || !t->rho) {
+    return false;
+  }
+
+  receiver->rcvd_tuple = t;
+  return true;
+}
+
+// position of index in the signing set, -1 if it is not a signer
+static int signer_position(const tuple_packet* tuple, int index) {
+  return signer_set_position(&tuple->S, index);
+}
+
+// λ of p_index in the signing set, from the cache rather than the tuple
+bool lagrange_coefficient(tuple_packet* tuple, int p_index, scalar* res) {
+  if (signer_position(tuple, p_index) < 0) {
+    printf("\nInvalid signing set for participant %d!\n", p_index);
+    return false;
+  }
+  return lagrange_cache_coefficient(tuple->S.indices, tuple->S.size, p_index,
+                                    res);
+}
+
+/* Hashes of FROST(P-256, SHA-256), RFC 9591 6.4. H1 (binding factors) and H2
+ * (challenge) are hash_to_field over expand_message_xmd (RFC 9380, 5.3.1)
+ * with 48 output bytes; H4 and H5 are plain SHA-256. */
+#define CONTEXT_STRING "FROST-P256-SHA256-v1"
+
+/* Prehash mode hashes under its own context string, as Ed25519ph does with
+ * dom2: a prehash encoding signed as a raw message gives a different
+ * challenge than the same encoding signed in prehash mode */
+#define PREHASH_CONTEXT_STRING "FROST-P256-SHA256-v1-ph"
+
+// The four domain-separated prefixes of one signing mode
+typedef struct {
+  const char* chal;  // H2 DST
+  const char* rho;   // H1 DST
+  const char* msg;   // H4 prefix
+  const char* com;   // H5 prefix
+} hash_domain;
+
+static const hash_domain domains[] = {
+    [SIGNING_RAW] = {CONTEXT_STRING "chal", CONTEXT_STRING "rho",
+                     CONTEXT_STRING "msg", CONTEXT_STRING "com"},
+    [SIGNING_PREHASHED] = {PREHASH_CONTEXT_STRING "chal",
+                           PREHASH_CONTEXT_STRING "rho",
+                           PREHASH_CONTEXT_STRING "msg",
+                           PREHASH_CONTEXT_STRING "com"},
+};
+#define HASH_TO_FIELD_LEN 48
+#define POINT_BYTES 33
+
+static bool encode_point(uint8_t out[POINT_BYTES], const EC_POINT* P) {
+  return EC_POINT_point2oct(EC_group_p256(), P, POINT_CONVERSION_COMPRESSED, out,
+                            POINT_BYTES, NULL) == POINT_BYTES;
+}
+
+/* identifiers are serialized as 32-byte big-endian scalars; a negative
+ * index, which has no identifier or would give the forbidden 0, is refused */
+static bool encode_identifier(uint8_t out[SCALAR_BYTES], int index) {
+  if (index < 0 || participant_identifier(index) == 0) {
+    return false;
+  }
+  scalar x;
+  scalar_set_word(&x, participant_identifier(index));
+  scalar_to_bytes(out, &x);
+  return true;
+}
+
+static void absorb_dst(SHA256_CTX* sha, const uint8_t* dst, size_t dst_len) {
+  uint8_t len_byte = (uint8_t)dst_len;
+  SHA256_Update(sha, dst, dst_len);
+  SHA256_Update(sha, &len_byte, 1);
+}
+
+/* sha has absorbed Z_pad || msg; writes len bytes of uniform output */
+static void expand_message_xmd(SHA256_CTX* sha, const uint8_t* dst,
+                               size_t dst_len, uint8_t* out, size_t len) {
+  uint8_t b0[SHA256_DIGEST_LENGTH], bi[SHA256_DIGEST_LENGTH];
+  uint8_t suffix[3] = {(uint8_t)(len >> 8), (uint8_t)len, 0};
+  SHA256_Update(sha, suffix, sizeof(suffix));
+  absorb_dst(sha, dst, dst_len);
+  SHA256_Final(b0, sha);
+
+  memset(bi, 0, sizeof(bi));
+  for (uint8_t i = 1; len > 0; i++) {
+    // b_i = H((b_0 xor b_(i-1)) || i || DST'), with b_0 xor 0 for i = 1
+    for (int k = 0; k < SHA256_DIGEST_LENGTH; k++) {
+      bi[k] ^= b0[k];
     }
+    SHA256_Init(sha);
+    SHA256_Update(sha, bi, sizeof(bi));
+    SHA256_Update(sha, &i, 1);
+    absorb_dst(sha, dst, dst_len);
+    SHA256_Final(bi, sha);
+
+    size_t take = len < sizeof(bi) ? len : sizeof(bi);
+    memcpy(out, bi, take);
+    out += take;
+    len -= take;
   }
+}
 
-  return a->tuple;
+// 48 bytes of expand_message_xmd left-padded to 64, reduced modulo n
+static void hash_to_scalar(SHA256_CTX* sha, const uint8_t* dst,
+                           size_t dst_len, scalar* out) {
+  uint8_t wide[2 * SCALAR_BYTES] = {0};
+  expand_message_xmd(sha, dst, dst_len, wide + sizeof(wide) - HASH_TO_FIELD_LEN,
+                     HASH_TO_FIELD_LEN);
+  scalar_from_wide(out, wide);
 }
 
-void free_tuple_packet(tuple_packet* tuple) {
-  if (tuple != NULL) {
-    if (tuple->m != NULL) {
-      free(tuple->m);
+/* Z_pad is exactly one SHA-256 block, so the state after it is the same for
+ * every challenge and is computed once per process, for SHA256_CTX and for
+ * multi-buffer lanes */
+static SHA256_CTX z_pad_state;
+static sha256_lane z_pad_lane;
+static pthread_once_t z_pad_once = PTHREAD_ONCE_INIT;
+
+static void init_z_pad_state() {
+  static const uint8_t z_pad[SHA256_CBLOCK] = {0};
+  SHA256_Init(&z_pad_state);
+  SHA256_Update(&z_pad_state, z_pad, sizeof(z_pad));
+  sha256_lane_init(&z_pad_lane, NULL);
+  sha256_lane_absorb(&z_pad_lane, z_pad, 1);
+}
+
+// Lanes hashed to scalars per round, bounding the stack buffers below
+#define HASH_LANE_BATCH 64
+#define DST_MAX 32  // room for the chal and rho DSTs of every domain
+
+/* hash_to_scalar for count <= HASH_LANE_BATCH messages at once. Each lane
+ * starts from z_pad_lane and holds its message in all but the last part; the
+ * three hashes of expand_message_xmd then run as three multi-buffer rounds. */
+static void hash_to_scalars(sha256_lane* lanes, size_t count,
+                            const uint8_t* dst, size_t dst_len, scalar* out) {
+  uint8_t suffix[3 + DST_MAX + 1] = {0, HASH_TO_FIELD_LEN, 0};
+  uint8_t b0[HASH_LANE_BATCH][SHA256_DIGEST_LENGTH];
+  uint8_t b2[HASH_LANE_BATCH][SHA256_DIGEST_LENGTH];
+  uint8_t in[HASH_LANE_BATCH][SHA256_DIGEST_LENGTH + 1 + DST_MAX + 1];
+  uint8_t wide[HASH_LANE_BATCH][2 * SCALAR_BYTES];
+  size_t dst_part = dst_len + 1, in_len = SHA256_DIGEST_LENGTH + 1 + dst_part;
+  const size_t b1_at = sizeof(wide[0]) - HASH_TO_FIELD_LEN;
+
+  // b_0 = H(Z_pad || msg || l_i_b_str || 0 || DST || len(DST))
+  memcpy(suffix + 3, dst, dst_len);
+  suffix[3 + dst_len] = (uint8_t)dst_len;
+  for (size_t i = 0; i < count; i++) {
+    sha256_lane_add(&lanes[i], suffix, 3 + dst_part);
+    lanes[i].out = b0[i];
+  }
+  sha256_lanes(lanes, count);
+
+  // b_1 = H(b_0 || 1 || DST'), written straight after 16 zero bytes of wide
+  for (size_t i = 0; i < count; i++) {
+    memcpy(in[i], b0[i], SHA256_DIGEST_LENGTH);
+    in[i][SHA256_DIGEST_LENGTH] = 1;
+    memcpy(in[i] + SHA256_DIGEST_LENGTH + 1, suffix + 3, dst_part);
+    memset(wide[i], 0, b1_at);
+    sha256_lane_init(&lanes[i], wide[i] + b1_at);
+    sha256_lane_add(&lanes[i], in[i], in_len);
+  }
+  sha256_lanes(lanes, count);
+
+  // b_2 = H((b_0 xor b_1) || 2 || DST'), of which 16 bytes are used
+  for (size_t i = 0; i < count; i++) {
+    for (int k = 0; k < SHA256_DIGEST_LENGTH; k++) {
+      in[i][k] = b0[i][k] ^ wide[i][b1_at + k];
     }
-    if (tuple->S != NULL) {
-      free(tuple->S);
+    in[i][SHA256_DIGEST_LENGTH] = 2;
+    sha256_lane_init(&lanes[i], b2[i]);
+    sha256_lane_add(&lanes[i], in[i], in_len);
+  }
+  sha256_lanes(lanes, count);
+
+  for (size_t i = 0; i < count; i++) {
+    memcpy(wide[i] + b1_at + SHA256_DIGEST_LENGTH, b2[i],
+           HASH_TO_FIELD_LEN - SHA256_DIGEST_LENGTH);
+    scalar_from_wide(&out[i], wide[i]);
+  }
+}
+
+// H2(R || Y || m) in the domain of mode
+static bool challenge_stream(scalar* out, const EC_POINT* R, const EC_POINT* Y,
+                             const message_source* m, signing_mode mode,
+                             uint64_t* m_size) {
+  uint8_t R_enc[POINT_BYTES], Y_enc[POINT_BYTES];
+  uint64_t absorbed;
+  // identity points have no 33-byte encoding and are rejected here
+  if (!encode_point(R_enc, R) || !encode_point(Y_enc, Y)) {
+    return false;
+  }
+
+  // msg = R || Y || m, streamed straight into the digest
+  pthread_once(&z_pad_once, init_z_pad_state);
+  SHA256_CTX sha = z_pad_state;
+  SHA256_Update(&sha, R_enc, sizeof(R_enc));
+  SHA256_Update(&sha, Y_enc, sizeof(Y_enc));
+  if (!message_absorb(&sha, m, &absorbed)) {
+    return false;
+  }
+  if (m_size != NULL) {
+    *m_size = absorbed;
+  }
+
+  const char* dst = domains[mode].chal;
+  hash_to_scalar(&sha, (const uint8_t*)dst, strlen(dst), out);
+  return true;
+}
+
+bool hash_func_stream(scalar* out, const EC_POINT* R, const EC_POINT* Y,
+                      const message_source* m, uint64_t* m_size) {
+  return challenge_stream(out, R, Y, m, SIGNING_RAW, m_size);
+}
+
+bool hash_func(scalar* out, const EC_POINT* R, const EC_POINT* Y,
+               const uint8_t* m, size_t m_size) {
+  message_source src = message_from_buffer(m, m_size);
+  return hash_func_stream(out, R, Y, &src, NULL);
+}
+
+bool hash_func_batch(scalar* out, bool* ok, const challenge_input* in,
+                     size_t count) {
+  sha256_lane lanes[HASH_LANE_BATCH];
+  uint8_t R_enc[HASH_LANE_BATCH][POINT_BYTES];
+  uint8_t Y_enc[HASH_LANE_BATCH][POINT_BYTES];
+  scalar c[HASH_LANE_BATCH];
+  size_t where[HASH_LANE_BATCH];
+  bool all = true;
+  const char* dst = domains[SIGNING_RAW].chal;
+
+  pthread_once(&z_pad_once, init_z_pad_state);
+  for (size_t lo = 0; lo < count; lo += HASH_LANE_BATCH) {
+    size_t len = count - lo < HASH_LANE_BATCH ? count - lo : HASH_LANE_BATCH;
+    size_t n = 0;
+    for (size_t i = lo; i < lo + len; i++) {
+      const challenge_input* x = &in[i];
+      ok[i] = x->R && x->Y && encode_point(R_enc[n], x->R) &&
+              encode_point(Y_enc[n], x->Y);
+      all = all && ok[i];
+      if (!ok[i]) continue;
+
+      lanes[n] = z_pad_lane;
+      sha256_lane_add(&lanes[n], R_enc[n], POINT_BYTES);
+      sha256_lane_add(&lanes[n], Y_enc[n], POINT_BYTES);
+      sha256_lane_add(&lanes[n], x->m, x->m_size);
+      where[n++] = i;
     }
-    if (tuple->R != NULL) {
-      BN_free(tuple->R);
+
+    hash_to_scalars(lanes, n, (const uint8_t*)dst, strlen(dst), c);
+    for (size_t j = 0; j < n; j++) {
+      out[where[j]] = c[j];
     }
-    tuple->m_size = 0;
-    tuple->S_size = 0;
-    free(tuple);
   }
+  return all;
 }
 
-bool accept_tuple(participant* receiver, tuple_packet* packet) {
-  receiver->rcvd_tuple = malloc(sizeof(tuple_packet));
-  receiver->rcvd_tuple->S = malloc(sizeof(participant) * packet->S_size);
-  receiver->rcvd_tuple->m = malloc(sizeof(char) * packet->m_size);
-  receiver->rcvd_tuple->R = BN_new();
+// H4(m) = SHA-256(contextString || "msg" || m)
+static bool hash_message(uint8_t out[SHA256_DIGEST_LENGTH],
+                         const message_source* m, const hash_domain* domain) {
+  uint64_t absorbed;
+  SHA256_CTX sha;
+  SHA256_Init(&sha);
+  SHA256_Update(&sha, domain->msg, strlen(domain->msg));
+  if (!message_absorb(&sha, m, &absorbed)) {
+    return false;
+  }
+  SHA256_Final(out, &sha);
+  return true;
+}
 
-  BN_copy(receiver->rcvd_tuple->R, packet->R);
-  receiver->rcvd_tuple->S_size = packet->S_size;
-  receiver->rcvd_tuple->m_size = packet->m_size;
+/*
+# ρ_i = H1(Y || H4(m) || H5(commitment list) || i), RFC 9591 4.4, where the
+# list is i || D_i || E_i for every signer in ascending i. The prefix is the
+# same for all signers and is encoded once; the t hashes run side by side.
+*/
+static bool binding_factors(tuple_packet* t, const EC_POINT* Y,
+                            const uint8_t msg_digest[SHA256_DIGEST_LENGTH],
+                            const hash_domain* domain) {
+  uint8_t enc[POINT_BYTES], id[SCALAR_BYTES];
+  uint8_t list_digest[SHA256_DIGEST_LENGTH];
+
+  SHA256_CTX sha;
+  SHA256_Init(&sha);
+  SHA256_Update(&sha, domain->com, strlen(domain->com));
+  for (size_t i = 0; i < t->S.size; i++) {
+    if (!encode_identifier(id, t->S.indices[i])) return false;
+    SHA256_Update(&sha, id, sizeof(id));
+    if (!encode_point(enc, t->hiding[i])) return false;
+    SHA256_Update(&sha, enc, sizeof(enc));
+    if (!encode_point(enc, t->binding[i])) return false;
+    SHA256_Update(&sha, enc, sizeof(enc));
+  }
+  SHA256_Final(list_digest, &sha);
 
-  for (int i = 0; i < packet->S_size; i++) {
-    receiver->rcvd_tuple->S[i] = packet->S[i];
+  // Y || H4(m) || H5(list)
+  uint8_t prefix[POINT_BYTES + 2 * SHA256_DIGEST_LENGTH];
+  if (!encode_point(prefix, Y)) {
+    return false;
   }
+  memcpy(prefix + POINT_BYTES, msg_digest, SHA256_DIGEST_LENGTH);
+  memcpy(prefix + POINT_BYTES + SHA256_DIGEST_LENGTH, list_digest,
+         sizeof(list_digest));
+
+  sha256_lane lanes[HASH_LANE_BATCH];
+  uint8_t ids[HASH_LANE_BATCH][SCALAR_BYTES];
+  pthread_once(&z_pad_once, init_z_pad_state);
+  for (size_t lo = 0; lo < t->S.size; lo += HASH_LANE_BATCH) {
+    size_t n = t->S.size - lo < HASH_LANE_BATCH ? t->S.size - lo
+                                                 : HASH_LANE_BATCH;
+    for (size_t i = 0; i < n; i++) {
+      // every index was encoded into the list above
+      encode_identifier(ids[i], t->S.indices[lo + i]);
+      lanes[i] = z_pad_lane;
+      sha256_lane_add(&lanes[i], prefix, sizeof(prefix));
+      sha256_lane_add(&lanes[i], ids[i], SCALAR_BYTES);
+    }
+    hash_to_scalars(lanes, n, (const uint8_t*)domain->rho,
+                    strlen(domain->rho), &t->rho[lo]);
+  }
+  return true;
+}
 
-  for (int i = 0; i < packet->m_size; i++) {
-    receiver->rcvd_tuple->m[i] = packet->m[i];
+/*
+# R = ∏ D_i * E_i ^ ρ_i: commitments and ρ are public, so one 2t-point MSM,
+# its inputs laid out in the session's arena
+*/
+static bool group_commitment(session_arena* arena, tuple_packet* t,
+                             frost_ctx* ctx) {
+  size_t count = 2 * t->S.size;
+  const EC_POINT** points = arena_alloc(arena, sizeof(EC_POINT*) * count);
+  scalar* weights = arena_alloc(arena, sizeof(scalar) * count);
+  t->R = arena_point_new(arena);
+  bool ok = points && weights && t->R;
+  for (size_t i = 0; ok && i < t->S.size; i++) {
+    points[2 * i] = t->hiding[i];
+    scalar_one(&weights[2 * i]);
+    points[2 * i + 1] = t->binding[i];
+    weights[2 * i + 1] = t->rho[i];
   }
+  return ok && msm(t->R, points, weights, count, ctx);
+}
 
-  return true;
+/* ρ, R and c = H2(R || Y || m) from the commitment list of t, Y and the
+ * message, written into t; R and the MSM inputs come from arena. The binding
+ * factors depend on H4(m) and the challenge on R, so m is read twice, from
+ * its first byte each time. */
+static bool derive_session(tuple_packet* t, const EC_POINT* Y,
+                           const message_source* m, signing_mode mode,
+                           session_arena* arena, uint64_t* m_size,
+                           frost_ctx* ctx) {
+  uint8_t msg_digest[SHA256_DIGEST_LENGTH];
+  return message_rewind(m) && hash_message(msg_digest, m, &domains[mode]) &&
+         binding_factors(t, Y, msg_digest, &domains[mode]) &&
+         group_commitment(arena, t, ctx) && message_rewind(m) &&
+         challenge_stream(&t->challenge, t->R, Y, m, mode, m_size);
 }
 
-BIGNUM* lagrange_coefficient(tuple_packet* tuple, int p_index) {
-  int num_participants = tuple->S_size;
-
-  // Initialize BIGNUMs
-  BN_CTX* ctx = BN_CTX_new();
-  BN_CTX* ctx2 = BN_CTX_new();
-  BN_CTX* ctx3 = BN_CTX_new();
-  BN_CTX* ctx4 = BN_CTX_new();
-  BIGNUM* numerator = BN_new();
-  BIGNUM* denominator = BN_new();
-  BIGNUM* res = BN_new();
-  BIGNUM* tmp = BN_new();
-  BIGNUM* Q_2 = BN_new();
-  BIGNUM* b_2 = BN_new();
-  BN_set_word(b_2, 2);
-
-  // Set values for numerator, denominator
-  BN_one(numerator);
-  BN_one(denominator);
-
-  for (int i = 0; i < num_participants; i++) {
-    int index = tuple->S[i].index;
-    BIGNUM* b_index = BN_new();
-    BIGNUM* b_p_index = BN_new();
-
-    BN_set_word(b_index, index);
-    BN_set_word(b_p_index, p_index);
-    BN_CTX_start(ctx);
-
-    if (index == p_index) {
-      BN_CTX_end(ctx);
-      BN_clear_free(b_index);
-      BN_clear_free(b_p_index);
-      continue;
-    }
-    BN_mul_word(numerator, index);
-    BN_sub(tmp, b_index, b_p_index);
-    BN_mul(denominator, denominator, tmp, ctx);
-
-    BN_CTX_end(ctx);
-    BN_clear_free(b_index);
-    BN_clear_free(b_p_index);
-  }
-
-  BN_sub(Q_2, order, b_2);
-  BN_mod_exp(tmp, denominator, Q_2, order, ctx2);
-  BN_mul(res, numerator, tmp, ctx3);
-  BN_mod(res, res, order, ctx4);
-
-  BN_CTX_free(ctx);
-  BN_CTX_free(ctx2);
-  BN_CTX_free(ctx3);
-  BN_CTX_free(ctx4);
-  BN_clear_free(numerator);
-  BN_clear_free(denominator);
-  BN_clear_free(tmp);
-  BN_clear_free(Q_2);
-  BN_clear_free(b_2);
-
-  return res;
-}
-
-BIGNUM* hash_func(BIGNUM* R, char* m) {
-  BN_CTX* ctx = BN_CTX_new();
-  char* R_hex = BN_bn2dec(R);
-  size_t hash_len = strlen(m) + strlen(R_hex);
-  char* concat = (char*)malloc(hash_len + 1);
-
-  strcpy(concat, m);
-  strcat(concat, R_hex);
-
-  unsigned char hash[SHA256_DIGEST_LENGTH];
-
-  EVP_MD_CTX* mdctx;
-  const EVP_MD* md;
-  md = EVP_sha256();
-
-  mdctx = EVP_MD_CTX_new();
-  EVP_DigestInit_ex(mdctx, md, NULL);
-  EVP_DigestUpdate(mdctx, concat, hash_len);
-  EVP_DigestFinal_ex(mdctx, hash, NULL);
-  EVP_MD_CTX_free(mdctx);
-
-  BIGNUM* hash_bn = BN_new();
-  BN_bin2bn(hash, SHA256_DIGEST_LENGTH, hash_bn);
-  BN_mod(hash_bn, hash_bn, order, ctx);
-
-  BN_CTX_free(ctx);
-  OPENSSL_free(R_hex);
-  free(concat);
-
-  return hash_bn;
-}
-
-BIGNUM* init_sig_share(participant* p) {
-  BN_CTX* ctx = BN_CTX_new();
-  BN_CTX* ctx2 = BN_CTX_new();
-  BN_CTX* ctx3 = BN_CTX_new();
-  BN_CTX* ctx4 = BN_CTX_new();
-  BIGNUM* sig_share = BN_new();
-  BIGNUM* tmp = BN_new();
-  BIGNUM* lambda = lagrange_coefficient(p->rcvd_tuple, p->index);
-  BN_one(tmp);
-
-  BIGNUM* hash = hash_func(p->rcvd_tuple->R, p->rcvd_tuple->m);
-
-  BN_mod_mul(tmp, tmp, hash, order, ctx);
-  BN_mod_mul(tmp, tmp, p->secret_share, order, ctx2);
-  BN_mod_mul(tmp, tmp, lambda, order, ctx3);
-  BN_mod_add(sig_share, p->nonce, tmp, order, ctx4);
-
-  BN_CTX_free(ctx);
-  BN_CTX_free(ctx2);
-  BN_CTX_free(ctx3);
-  BN_CTX_free(ctx4);
-  BN_clear_free(hash);
-  BN_clear_free(lambda);
-  BN_clear_free(tmp);
-  BN_clear_free(p->nonce);
-  free_pub_share(p->pub_share);
-  free_tuple_packet(p->rcvd_tuple);
+static bool bind_session(aggregator* a, const message_source* m,
+                         signing_mode mode, frost_ctx* ctx) {
+  tuple_packet* t = a->tuple;
+  uint64_t m_size;
+  if (!derive_session(t, a->public_key, m, mode, session_memory(a), &m_size,
+                      ctx)) {
+    return false;
+  }
 
-  return sig_share;
+  t->m_size = (size_t)m_size;
+  a->hash = t->challenge;
+  a->R_pub_commit = t->R;
+  return true;
 }
 
-rcvd_sig_shares* create_node_sig_share(BIGNUM* sig_share) {
-  rcvd_sig_shares* newNode = (rcvd_sig_shares*)malloc(sizeof(rcvd_sig_shares));
-  newNode->rcvd_share = BN_new();
-  newNode->next = NULL;
+// The list names, for the pair p is asked to use, the (D, E) p published
+static bool own_commitment(const participant* p, const tuple_packet* t,
+                           int position, session_arena* arena,
+                           frost_ctx* ctx) {
+  EC_POINT* hiding = arena_point_new(arena);
+  EC_POINT* binding = arena_point_new(arena);
+  return hiding && binding &&
+         nonce_store_commitment(p->nonces, t->nonce_ids[position], hiding,
+                                binding, ctx) &&
+         EC_POINT_cmp(ctx->group, hiding, t->hiding[position], ctx->bn) == 0 &&
+         EC_POINT_cmp(ctx->group, binding, t->binding[position], ctx->bn) == 0;
+}
 
-  BN_copy(newNode->rcvd_share, sig_share);
+bool init_sig_share(participant* p, const message_source* m,
+                    signing_mode mode, scalar* sig_share, frost_ctx* ctx) {
+  tuple_packet* t = p->rcvd_tuple;
+  int position = signer_position(t, p->index);
+  scalar d, e, lambda, tmp;
+  if (position < 0) {
+    printf("\nInvalid signing set for participant %d!\n", p->index);
+    return false;
+  }
 
-  return newNode;
+  /* Nothing but the commitment list is taken from the aggregator (RFC 9591
+   * 5.2): it must hold this signer's own commitments, and ρ, R, c and λ are
+   * derived here from it, Y and the message the signer means to sign */
+  session_arena* arena = participant_memory(p);
+  if (p->nonces == NULL || !own_commitment(p, t, position, arena, ctx)) {
+    printf("\nTuple does not hold the commitments of participant %d!\n",
+           p->index);
+    return false;
+  }
+  if (!derive_session(t, p->public_key, m, mode, arena, NULL, ctx) ||
+      !lagrange_coefficient(t, p->index, &lambda)) {
+    printf("\nInvalid group commitment or unreadable message!\n");
+    return false;
+  }
+
+  // the pair leaves the store here, whatever happens next
+  if (!nonce_store_take(p->nonces, t->nonce_ids[position], &d, &e)) {
+    printf("\nNonce pair %u of participant %d is unknown or used!\n",
+           t->nonce_ids[position], p->index);
+    return false;
+  }
+
+  // z_i = d_i + e_i * ρ_i + λ_i * s_i * c
+  scalar_mul(&tmp, &t->challenge, &p->secret_share);
+  scalar_mul(&tmp, &tmp, &lambda);
+  scalar_add(sig_share, &d, &tmp);
+  scalar_mul(&tmp, &e, &t->rho[position]);
+  scalar_add(sig_share, sig_share, &tmp);
+
+  scalar_cleanse(&tmp);
+  scalar_cleanse(&d);
+  scalar_cleanse(&e);
+  p->rcvd_tuple = NULL;
+
+  return true;
 }
 
-void free_rcvd_sig_share(rcvd_sig_shares* node) {
-  rcvd_sig_shares* curr = node;
-  while (curr != NULL) {
-    rcvd_sig_shares* next = curr->next;
-    BN_clear_free(curr->rcvd_share);
-    free(curr);
-    curr = next;
+// Wipes the responses of the session; the slots are reused by the next one
+void free_rcvd_sig_shares(aggregator* agg) {
+  if (agg->rcvd_sig_shares != NULL) {
+    OPENSSL_cleanse(agg->rcvd_sig_shares, sizeof(scalar) * agg->participants);
   }
+  presence_clear(&agg->sig_shares_in);
 }
 
-void insert_node_sig_share(aggregator* agg, BIGNUM* sig_share) {
-  rcvd_sig_shares* newNode = create_node_sig_share(sig_share);
+// One response per sender: a second one is refused
+bool insert_sig_share(aggregator* agg, int sender_index,
+                      const scalar* sig_share) {
+  if (agg->rcvd_sig_shares == NULL) {
+    scalar* shares = arena_alloc(agg->arena, sizeof(scalar) * agg->participants);
+    if (shares == NULL ||
+        !presence_init(&agg->sig_shares_in, agg->arena, agg->participants)) {
+      return false;
+    }
+    agg->rcvd_sig_shares = shares;
+  }
+  if (!valid_sender(agg, sender_index) ||
+      !presence_add(&agg->sig_shares_in, sender_index)) {
+    return false;
+  }
+  agg->rcvd_sig_shares[sender_index] = *sig_share;
+  return true;
+}
 
-  newNode->next = agg->rcvd_sig_shares_head;
-  agg->rcvd_sig_shares_head = newNode;
+/*
+# z_i ?= D_i * E_i ^ ρ_i * Y_i ^ (c * λ_i), checked as
+# G ^ z_i * Y_i ^ -(c * λ_i) = D_i * E_i ^ ρ_i
+*/
+static bool verify_response(const aggregator* a, int position,
+                            const scalar* sig_share, frost_ctx* ctx) {
+  const pub_share_packet* sender = a->session_shares[position];
+  scalar c_lambda;
+  EC_POINT* lhs = group_point_new();
+  EC_POINT* rhs = group_point_new();
+  scalar_mul(&c_lambda, &a->hash, &a->tuple->lambda[position]);
+  scalar_neg(&c_lambda, &c_lambda);
+  bool verified =
+      lhs && rhs &&
+      group_double_mul(lhs, sig_share, sender->verify_share, &c_lambda,
+                       ctx) &&
+      group_mul(rhs, sender->binding_share, &a->tuple->rho[position], ctx) &&
+      EC_POINT_add(ctx->group, rhs, rhs, sender->pub_share, ctx->bn) &&
+      EC_POINT_cmp(ctx->group, lhs, rhs, ctx->bn) == 0;
+
+  EC_POINT_free(lhs);
+  EC_POINT_free(rhs);
+  return verified;
 }
 
-bool accept_sig_share(aggregator* receiver, BIGNUM* sig_share,
-                      int sender_index) {
-  if (receiver->rcvd_sig_shares_head == NULL) {
-    receiver->rcvd_sig_shares_head = create_node_sig_share(sig_share);
-  } else {
-    insert_node_sig_share(receiver, sig_share);
+bool accept_sig_share(aggregator* receiver, const scalar* sig_share,
+                      int sender_index, frost_ctx* ctx) {
+  if (!insert_sig_share(receiver, sender_index, sig_share)) {
+    return false;
   }
 
   /*
   # Verifies the validity of each response by checking
-  zi ?= Di * Yi ^ (c * λi)
+  z_i ?= D_i * E_i ^ ρ_i * Y_i ^ (c * λ_i)
   */
 
-  pub_share_packet* sender_pub_share =
-      search_node_pub_share(receiver->rcvd_pub_share_head, sender_index);
-
-  BN_CTX* ctx = BN_CTX_new();
-  BN_CTX* ctx2 = BN_CTX_new();
-  BN_CTX* ctx3 = BN_CTX_new();
-  BN_CTX* ctx4 = BN_CTX_new();
-  BIGNUM* res_G_over_zi = BN_new();
-  receiver->hash = BN_new();
-  BIGNUM* tmp = BN_new();
-  BIGNUM* Yi = BN_new();
-  BIGNUM* Di = BN_new();
-  BIGNUM* c = hash_func(receiver->R_pub_commit, receiver->tuple->m);
-  BIGNUM* res_power = BN_new();
-  receiver->public_key = BN_new();
-  BIGNUM* lambda;
-  BN_copy(Yi, sender_pub_share->verify_share);
-  BN_copy(Di, sender_pub_share->pub_share);
-  BN_copy(receiver->hash, c);
-  BN_copy(receiver->public_key,
-          receiver->rcvd_pub_share_head->rcvd_packets->public_key);
-
-  for (int i = 0; i < receiver->tuple->S_size; i++) {
-    if (receiver->tuple->S[i].index == sender_index) {
-      lambda = lagrange_coefficient(receiver->tuple, sender_index);
-    }
+  int position = signer_position(receiver->tuple, sender_index);
+  if (position < 0) {
+    printf("\nSigning response from outside the signing set!\n");
+    abort();
   }
 
-  BN_mod_mul(res_G_over_zi, b_generator, sig_share, order, ctx);
-
-  BN_mod_mul(res_power, c, lambda, order, ctx2);
-  BN_mod_mul(tmp, Yi, res_power, order, ctx3);
-  BN_mod_add(tmp, tmp, Di, order, ctx4);
-
-  if (!BN_cmp(res_G_over_zi, tmp)) {
-    BN_CTX_free(ctx);
-    BN_CTX_free(ctx2);
-    BN_CTX_free(ctx3);
-    BN_CTX_free(ctx4);
-    BN_clear_free(sig_share);
-    BN_clear_free(res_G_over_zi);
-    BN_clear_free(tmp);
-    BN_clear_free(Yi);
-    BN_clear_free(Di);
-    BN_clear_free(c);
-    BN_clear_free(lambda);
-    BN_clear_free(res_power);
+  bool verified = verify_response(receiver, position, sig_share, ctx);
 
+  if (verified) {
     return true;
   } else {
     printf("\nVerification of signing response failed!\n");
@@ -449,20 +851,91 @@ bool accept_sig_share(aggregator* receiver, BIGNUM* sig_share,
   }
 }
 
-BIGNUM* gen_signature(rcvd_sig_shares* head) {
-  BN_CTX* ctx = BN_CTX_new();
-  BIGNUM* sum = BN_new();
-  BN_zero(sum);
+bool store_sig_share(aggregator* receiver, const scalar* sig_share,
+                     int sender_index) {
+  return receiver->tuple != NULL &&
+         signer_position(receiver->tuple, sender_index) >= 0 &&
+         insert_sig_share(receiver, sender_index, sig_share);
+}
 
-  while (head != NULL) {
-    BN_CTX_start(ctx);
-    BN_mod_add(sum, sum, head->rcvd_share, order, ctx);
-    BN_CTX_end(ctx);
-    head = head->next;
+/*
+# All responses at once, with random w_i per signer:
+# G ^ (∑ w_i * z_i) ?= ∏ D_i ^ w_i * E_i ^ (w_i * ρ_i) * Y_i ^ (w_i * c * λ_i)
+# One fixed-base multiplication and one 3t-point MSM replace t double
+# multiplications. z_i and the commitments are public, so the variable-time
+# MSM is fine here.
+*/
+static bool verify_sig_shares_combined(aggregator* a, frost_ctx* ctx) {
+  size_t count = a->tuple->S.size;
+  session_arena* arena = session_memory(a);
+  const EC_POINT** points = arena_alloc(arena, sizeof(EC_POINT*) * 3 * count);
+  scalar* weights = arena_alloc(arena, sizeof(scalar) * 3 * count);
+  EC_POINT* lhs = arena_point_new(arena);
+  EC_POINT* rhs = arena_point_new(arena);
+  // a response from every signer and from nobody else
+  bool ok = points && weights && lhs && rhs &&
+            a->sig_shares_in.count == count;
+
+  scalar combined, w, weighted;
+  scalar_zero(&combined);
+  for (size_t position = 0; ok && position < count; position++) {
+    int sender_index = a->tuple->S.indices[position];
+    ok = presence_test(&a->sig_shares_in, sender_index) &&
+         generate_rand(ctx, &w);
+    if (!ok) break;
+
+    const pub_share_packet* sender = a->session_shares[position];
+    points[3 * position] = sender->pub_share;
+    points[3 * position + 1] = sender->binding_share;
+    points[3 * position + 2] = sender->verify_share;
+    weights[3 * position] = w;
+    scalar_mul(&weights[3 * position + 1], &w, &a->tuple->rho[position]);
+    scalar_mul(&weighted, &w, &a->hash);
+    scalar_mul(&weights[3 * position + 2], &weighted,
+               &a->tuple->lambda[position]);
+    scalar_mul(&weighted, &w, &a->rcvd_sig_shares[sender_index]);
+    scalar_add(&combined, &combined, &weighted);
   }
 
-  BN_CTX_free(ctx);
-  return sum;
+  ok = ok && group_base_mul(lhs, &combined, ctx) &&
+       msm(rhs, points, weights, 3 * count, ctx) &&
+       EC_POINT_cmp(ctx->group, lhs, rhs, ctx->bn) == 0;
+  return ok;
+}
+
+bool verify_sig_shares(aggregator* receiver, int* blamed,
+                       size_t* blamed_count, frost_ctx* ctx) {
+  *blamed_count = 0;
+  if (receiver->tuple == NULL) {
+    return false;
+  }
+  if (verify_sig_shares_combined(receiver, ctx)) {
+    return true;
+  }
+
+  /* the combined check failed: name every signer of S whose response is
+   * missing or fails on its own */
+  const signer_set* S = &receiver->tuple->S;
+  const presence_map* in = &receiver->sig_shares_in;
+  for (size_t position = 0; position < S->size; position++) {
+    int index = S->indices[position];
+    if (!presence_test(in, index) ||
+        !verify_response(receiver, (int)position,
+                         &receiver->rcvd_sig_shares[index], ctx)) {
+      blamed[(*blamed_count)++] = index;
+    }
+  }
+  return false;
+}
+
+void gen_signature(const aggregator* agg, scalar* sum) {
+  scalar_zero(sum);
+  const presence_map* in = &agg->sig_shares_in;
+
+  for (size_t j = presence_next(in, 0); j < in->size;
+       j = presence_next(in, j + 1)) {
+    scalar_add(sum, sum, &agg->rcvd_sig_shares[j]);
+  }
 }
 
 signature_packet signature(aggregator* agg) {
@@ -470,28 +943,32 @@ signature_packet signature(aggregator* agg) {
     # 1. Compute the group’s response z = ∑ z_i
     # 2. Publish the signature σ = (z, c) along with the message m
     */
-    BIGNUM* signature = gen_signature(agg->rcvd_sig_shares_head);
-
-    signature_packet sig_packet;
-    sig_packet.hash = BN_new();
-    sig_packet.signature = BN_new();
-
-    // Copy BIGNUM values to the signature_packet
-    BN_copy(sig_packet.signature, signature);
-    BN_copy(sig_packet.hash, agg->hash);
-
-
-    // Cleanup BIGNUM objects
-    BN_clear_free(signature);
-    BN_clear_free(agg->R_pub_commit);
-    BN_clear_free(agg->hash);
-    free_node_pub_share(agg->rcvd_pub_share_head);
-    free_tuple_packet(agg->tuple);
-    free_rcvd_sig_share(agg->rcvd_sig_shares_head);
-
+    signature_packet sig_packet = {0};
+    signature_into(agg, &sig_packet);
     return sig_packet;
 }
 
+bool signature_into(aggregator* agg, signature_packet* sig) {
+  scalar signature;
+  gen_signature(agg, &signature);
+
+  if (sig->hash == NULL) sig->hash = BN_new();
+  if (sig->signature == NULL) sig->signature = BN_new();
+  if (sig->R == NULL) sig->R = group_point_new();
+
+  // Export the scalars into the signature_packet
+  bool ok = sig->hash && sig->signature && sig->R &&
+            scalar_to_bn(&signature, sig->signature) &&
+            scalar_to_bn(&agg->hash, sig->hash) &&
+            EC_POINT_copy(sig->R, agg->R_pub_commit);
+
+  // unused commitments stay pooled for later sessions
+  scalar_cleanse(&signature);
+  free_session(agg);
+  free_rcvd_sig_shares(agg);
+  return ok;
+}
+
 BIGNUM* hex_string_to_bn(const char* hex_str) {
     if (hex_str == NULL) {
         return NULL; // Invalid input
@@ -506,39 +983,32 @@ BIGNUM* hex_string_to_bn(const char* hex_str) {
     return bn;
 }
 
-bool verify_signature(char* signature_hex, char* hash_hex, char* m, BIGNUM* Y) {
-  BIGNUM* R0 = BN_new();
-  BIGNUM* z0 = BN_new();
-  BIGNUM* temp1 = BN_new();
-  BIGNUM* temp2 = BN_new();
-  BIGNUM* temp3 = BN_new();
-  BN_CTX* ctx = BN_CTX_new();
-  BN_CTX* ctx2 = BN_CTX_new();
-  BN_CTX* ctx3 = BN_CTX_new();
-
+// c ?= H2(G ^ z * Y ^ -c || Y || m) in the domain of mode
+static bool verify_in_mode(char* signature_hex, char* hash_hex,
+                           const message_source* m, signing_mode mode,
+                           const EC_POINT* Y, frost_ctx* ctx) {
+  EC_POINT* R0 = group_point_new();
   BIGNUM* signature = hex_string_to_bn(signature_hex);
   BIGNUM* hash = hex_string_to_bn(hash_hex);
+  scalar z, c, z0;
+  bool verified = false;
+
+  if (R0 && signature && hash && scalar_from_bn(&z, signature) &&
+      scalar_from_bn(&c, hash)) {
+    // Compute R0 = g^z * Y^-c
+    scalar minus_c;
+    scalar_neg(&minus_c, &c);
+    if (group_double_mul(R0, &z, Y, &minus_c, ctx)) {
+      verified = challenge_stream(&z0, R0, Y, m, mode, NULL) &&
+                 scalar_equal(&c, &z0);
+    }
+  }
 
-  // Compute R0 = g^z * Y^-c mod order
-  BN_mod_mul(temp1, b_generator, signature, order, ctx);
-  BN_mod_mul(temp3, Y, hash, order, ctx2);
-  BN_mod_sub(R0, temp1, temp3, order, ctx3);
-
-  z0 = hash_func(R0, m);
-
-  if (!BN_cmp(hash, z0)) {
-    BN_clear_free(R0);
-    BN_clear_free(z0);
-    BN_clear_free(temp1);
-    BN_clear_free(temp2);
-    BN_clear_free(temp3);
-    BN_clear_free(signature);
-    BN_clear_free  (hash);
-    BN_CTX_free(ctx);
-    BN_CTX_free(ctx2);
-    BN_CTX_free(ctx3);
-    //free_curve(); //disabled for test app; otherwise mandatory to enable the cleaning
+  EC_POINT_free(R0);
+  BN_clear_free(signature);
+  BN_clear_free(hash);
 
+  if (verified) {
     printf("\nSignature is verified!\n");
     return true;
   } else {
@@ -546,3 +1016,28 @@ bool verify_signature(char* signature_hex, char* hash_hex, char* m, BIGNUM* Y) {
     return false;
   }
 }
+
+bool verify_signature_stream(char* signature_hex, char* hash_hex,
+                             const message_source* m, const EC_POINT* Y,
+                             frost_ctx* ctx) {
+  return verify_in_mode(signature_hex, hash_hex, m, SIGNING_RAW, Y, ctx);
+}
+
+bool verify_signature(char* signature_hex, char* hash_hex, char* m,
+                      const EC_POINT* Y, frost_ctx* ctx) {
+  message_source src = message_from_buffer((const uint8_t*)m, strlen(m));
+  return verify_signature_stream(signature_hex, hash_hex, &src, Y, ctx);
+}
+
+bool verify_signature_prehashed(char* signature_hex, char* hash_hex,
+                                const message_source* m, int threads,
+                                const EC_POINT* Y, frost_ctx* ctx) {
+  uint8_t prehash[PREHASH_BYTES];
+  if (!prehash_message(m, threads, prehash)) {
+    printf("\nMessage could not be read!\n");
+    return false;
+  }
+  message_source src = message_from_buffer(prehash, sizeof(prehash));
+  return verify_in_mode(signature_hex, hash_hex, &src, SIGNING_PREHASHED, Y,
+                        ctx);
+}
@@ -0,0 +1,11 @@
+#!/bin/sh
+# Runs a cross-compiled test binary on the device or emulator adb is
+# connected to; ctest uses it as CMAKE_CROSSCOMPILING_EMULATOR. The exit
+# status is the test's own.
+set -e
+dir=/data/local/tmp/frost-tests
+name=$(basename "$1")
+adb shell mkdir -p "$dir"
+adb push "$1" "$dir/$name" >/dev/null
+shift
+adb shell "cd $dir && ./$name $*"
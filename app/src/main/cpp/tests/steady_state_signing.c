@@ -0,0 +1,204 @@
+#include "../boringssl/include/openssl/bn.h"
+#include "../boringssl/include/openssl/mem.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../headers/alloc_stats.h"
+#include "../headers/arena.h"
+#include "../headers/commit_store.h"
+#include "../headers/context.h"
+#include "../headers/message.h"
+#include "../headers/nonce.h"
+#include "../headers/setup.h"
+#include "../headers/signer_set.h"
+#include "../headers/signing.h"
+
+/*
+ * Steady-state signing must not touch the heap. A fresh t-of-n group signs
+ * with session arenas for the aggregator and the signers; WARMUP_SESSIONS
+ * size every buffer, then the allocations of COUNTED_SESSIONS more are
+ * counted (alloc_stats.h) and any of them fails the test. Built only as the
+ * steady_state_signing test, with the allocator wrapped (CMakeLists.txt).
+ */
+#define WARMUP_SESSIONS 2
+#define COUNTED_SESSIONS 16
+
+typedef struct {
+  int threshold;
+  int participants;
+  session_arena* arena;
+  participant* p;
+  signer_set signers;
+  aggregator agg;
+  int* blamed;
+} group;
+
+// Pedersen DKG among all participants through one shared commitment store
+static bool run_dkg(group* g, frost_ctx* ctx) {
+  int n = g->participants;
+  commit_store* store = commit_store_new(n, g->threshold);
+  int* receivers = arena_alloc(g->arena, sizeof(int) * n);
+  bool ok = store != NULL && receivers != NULL;
+  for (int i = 0; ok && i < n; i++) {
+    pub_commit_packet* commit = init_pub_commit(&g->p[i], ctx);
+    ok = commit != NULL && publish_pub_commit(store, commit, ctx);
+    receivers[i] = i;
+  }
+  for (int i = 0; ok && i < n; i++) {
+    ok = accept_commit_store(&g->p[i], store);
+  }
+  commit_store_release(store);
+
+  for (int i = 0; ok && i < n; i++) {
+    scalar* shares = init_sec_shares(&g->p[i], receivers, n);
+    ok = shares != NULL;
+    for (int j = 0; ok && j < n; j++) {
+      ok = store_sec_share(&g->p[j], i, &shares[j]);
+    }
+    if (shares != NULL) {
+      free_sec_shares(shares, n);
+    }
+  }
+
+  int* blamed = arena_alloc(g->arena, sizeof(int) * n);
+  size_t blamed_count;
+  for (int i = 0; ok && i < n; i++) {
+    ok = blamed != NULL &&
+         verify_sec_shares(&g->p[i], blamed, &blamed_count, ctx);
+  }
+  for (int i = 0; ok && i < n; i++) {
+    gen_keys(&g->p[i], ctx);
+  }
+  return ok;
+}
+
+// Signers 0 .. t-1, each with a session arena and `sessions` nonce pairs
+static bool prepare_signers(group* g, size_t sessions, frost_ctx* ctx) {
+  int t = g->threshold;
+  int* indices = arena_alloc(g->arena, sizeof(int) * t);
+  g->blamed = arena_alloc(g->arena, sizeof(int) * t);
+  g->agg = (aggregator){.arena = g->arena,
+                        .threshold = t,
+                        .participants = g->participants,
+                        .session = arena_new()};
+  bool ok = indices != NULL && g->blamed != NULL && g->agg.session != NULL;
+  for (int i = 0; ok && i < t; i++) {
+    indices[i] = i;
+  }
+  ok = ok &&
+       signer_set_init(&g->signers, g->arena, indices, t, g->participants);
+
+  for (int i = 0; ok && i < t; i++) {
+    participant* signer = &g->p[i];
+    signer->session = arena_new();
+    pub_share_packet* batch = signer->session != NULL
+                                  ? init_pub_shares(signer, sessions, ctx)
+                                  : NULL;
+    ok = batch != NULL;
+    for (size_t k = 0; ok && k < sessions; k++) {
+      ok = accept_pub_share(&g->agg, &batch[k]);
+    }
+  }
+  return ok;
+}
+
+// One session, from the tuple to the signature written into sig
+static bool sign_once(group* g, const message_source* m,
+                      signature_packet* sig, frost_ctx* ctx) {
+  const signer_set* S = &g->signers;
+  if (init_tuple_packet_stream(&g->agg, m, SIGNING_RAW, S->indices,
+                               (int)S->size, ctx) == NULL) {
+    return false;
+  }
+  bool ok = true;
+  for (size_t i = 0; ok && i < S->size; i++) {
+    ok = accept_tuple(&g->p[S->indices[i]], g->agg.tuple);
+  }
+  for (size_t i = 0; ok && i < S->size; i++) {
+    scalar sig_share;
+    ok = init_sig_share(&g->p[S->indices[i]], m, SIGNING_RAW, &sig_share,
+                        ctx) &&
+         store_sig_share(&g->agg, &sig_share, S->indices[i]);
+    scalar_cleanse(&sig_share);
+  }
+  size_t blamed_count;
+  return ok && verify_sig_shares(&g->agg, g->blamed, &blamed_count, ctx) &&
+         signature_into(&g->agg, sig);
+}
+
+static void free_group(group* g) {
+  for (int i = 0; g->p != NULL && i < g->participants; i++) {
+    nonce_store_free(g->p[i].nonces);
+    arena_free(g->p[i].session);
+    OPENSSL_cleanse(&g->p[i].secret_share, sizeof(scalar));
+    EC_POINT_free(g->p[i].verify_share);
+    EC_POINT_free(g->p[i].public_key);
+  }
+  arena_free(g->agg.session);
+  arena_free(g->arena);
+  free(g->p);
+}
+
+/* Allocations of COUNTED_SESSIONS sessions after the warm-up, or -1 if the
+ * group could not be set up or a session failed */
+static long long steady_state_allocations(int threshold, int participants) {
+  frost_ctx* ctx = frost_thread_ctx();
+  group g = {.threshold = threshold,
+             .participants = participants,
+             .arena = arena_new(),
+             .p = calloc(participants, sizeof(participant))};
+  bool ok = ctx != NULL && g.arena != NULL && g.p != NULL;
+  for (int i = 0; ok && i < participants; i++) {
+    g.p[i].arena = g.arena;
+    g.p[i].index = i;
+    g.p[i].threshold = threshold;
+    g.p[i].participants = participants;
+  }
+  ok = ok && run_dkg(&g, ctx) &&
+       prepare_signers(&g, WARMUP_SESSIONS + COUNTED_SESSIONS, ctx);
+
+  static const char text[] = "FROST steady-state signing test";
+  message_source m =
+      message_from_buffer((const uint8_t*)text, sizeof(text) - 1);
+  signature_packet sig = {0};
+  for (int s = 0; ok && s < WARMUP_SESSIONS; s++) {
+    ok = sign_once(&g, &m, &sig, ctx);
+  }
+
+  alloc_counters before, after;
+  alloc_phase previous = alloc_phase_enter(ALLOC_PHASE_SIGN);
+  alloc_stats_get(ALLOC_PHASE_SIGN, &before);
+  for (int s = 0; ok && s < COUNTED_SESSIONS; s++) {
+    ok = sign_once(&g, &m, &sig, ctx);
+  }
+  alloc_stats_get(ALLOC_PHASE_SIGN, &after);
+  alloc_phase_enter(previous);
+
+  BN_free(sig.signature);
+  BN_free(sig.hash);
+  EC_POINT_free(sig.R);
+  free_group(&g);
+  return ok ? (long long)(after.allocs - before.allocs) : -1;
+}
+
+int main() {
+  if (!alloc_stats_enabled()) {
+    printf("allocations are not counted: build with FROST_ALLOC_STATS\n");
+    return 1;
+  }
+
+  static const int groups[][2] = {{2, 3}, {3, 5}};
+  bool ok = true;
+  for (size_t i = 0; i < sizeof(groups) / sizeof(groups[0]); i++) {
+    long long allocations = steady_state_allocations(groups[i][0],
+                                                     groups[i][1]);
+    if (allocations < 0) {
+      printf("%d-of-%d: signing failed\n", groups[i][0], groups[i][1]);
+    } else {
+      printf("%d-of-%d: %lld allocations in %d sessions\n", groups[i][0],
+             groups[i][1], allocations, COUNTED_SESSIONS);
+    }
+    ok = ok && allocations == 0;
+  }
+  return ok ? 0 : 1;
+}